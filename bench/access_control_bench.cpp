@@ -0,0 +1,398 @@
+/////////////////////////////////////////////
+// Copyright (c) Gaia Platform LLC
+// All rights reserved.
+/////////////////////////////////////////////
+
+// End-to-end benchmark of the scan pipeline.
+//
+// Populates a synthetic site, then feeds JSON scans through the same ingest
+// queue that the MQTT connection uses, and captures the published messages
+// in-process through a publish sink. For every scan it measures the time
+// from message receipt to the first message the rules publish in response:
+//
+//     badge, joining_wifi, leaving_wifi,
+//     vehicle_entering, vehicle_departing  ->  access_control/<person_id>/scan
+//     face (into a room)                   ->  access_control/<person_id>/move_to_room
+//     leaving (a room)                     ->  access_control/<person_id>/move_to_building
+//     stranger (face of an unknown person) ->  access_control/alert
+//
+// To keep the attribution unambiguous, a person never has more than one
+// scan in flight, and "leaving" is only sent for people who are in a room.
+//
+// Requires a running gaia_db_server. Options (all optional):
+//
+//     --persons <n>            employees on the site (1000)
+//     --rooms <n>              rooms in the single building (20)
+//     --scans <n>              scans to send after warm-up (100000)
+//     --mix <type=weight,...>  scan mix, e.g. "face=50,leaving=30,badge=20"
+//     --rate <n>               average scans per second, 0 for unthrottled (0)
+//     --burst-size <n>         scans sent back-to-back per burst (1)
+//     --drain-timeout-ms <ms>  how long to wait for the last responses (10000)
+//
+// plus any of the application's tuning options (--scan-workers, ...).
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "app.hpp"
+#include "communication.hpp"
+#include "config.hpp"
+#include "helpers.hpp"
+#include "ingest.hpp"
+
+#include "gaia/db/db.hpp"
+#include "gaia/system.hpp"
+
+using namespace gaia::access_control;
+using std::chrono::steady_clock;
+
+const char c_scan_topic[] = "bench/access_control/scan";
+const char c_default_mix[] = "badge=10,joining_wifi=5,leaving_wifi=5,vehicle_entering=5,vehicle_departing=5,"
+                             "face=40,leaving=25,stranger=5";
+
+constexpr uint64_t c_building_id = 1;
+constexpr uint64_t c_first_room_id = 1000;
+
+// Unknown person IDs used for stranger scans start here.
+constexpr uint64_t c_first_stranger_id = 1000000000;
+
+const std::vector<std::string> c_scan_types = {
+    "badge", "joining_wifi", "leaving_wifi", "vehicle_entering", "vehicle_departing", "face", "leaving", "stranger"};
+
+// Receipt time of each person's in-flight scan, in steady_clock
+// nanoseconds; 0 when the person has none.
+std::vector<std::atomic<int64_t>> g_in_flight_since;
+
+// Stranger alerts carry no person ID, so they are matched to stranger scans
+// in the order the scans were sent.
+std::mutex g_stranger_lock;
+std::vector<int64_t> g_stranger_scans;
+size_t g_next_stranger_response = 0;
+
+std::mutex g_latency_lock;
+std::vector<int64_t> g_latencies_ns;
+
+int64_t now_ns()
+{
+    return steady_clock::now().time_since_epoch().count();
+}
+
+void record_latency(int64_t sent_ns)
+{
+    int64_t latency_ns = now_ns() - sent_ns;
+    std::lock_guard lock(g_latency_lock);
+    g_latencies_ns.push_back(latency_ns);
+}
+
+void publish_sink(const std::string& topic, const std::string& payload)
+{
+    const std::string prefix = "access_control/";
+    if (topic.compare(0, prefix.size(), prefix) != 0)
+    {
+        return;
+    }
+
+    if (topic == "access_control/alert")
+    {
+        if (payload != "Stranger detected")
+        {
+            return;
+        }
+
+        std::lock_guard lock(g_stranger_lock);
+        if (g_next_stranger_response < g_stranger_scans.size())
+        {
+            record_latency(g_stranger_scans[g_next_stranger_response++]);
+        }
+        return;
+    }
+
+    // access_control/<person_id>/<event>
+    size_t slash = topic.find('/', prefix.size());
+    if (slash == std::string::npos)
+    {
+        return;
+    }
+
+    uint64_t person_id = std::strtoull(topic.c_str() + prefix.size(), nullptr, 10);
+    if (person_id == 0 || person_id > g_in_flight_since.size())
+    {
+        return;
+    }
+
+    int64_t sent_ns = g_in_flight_since[person_id - 1].exchange(0);
+    if (sent_ns != 0)
+    {
+        record_latency(sent_ns);
+    }
+}
+
+// Parses "type=weight,..." into one weight per entry of c_scan_types.
+bool parse_mix(const std::string& mix, std::vector<double>& weights)
+{
+    weights.assign(c_scan_types.size(), 0);
+
+    size_t start = 0;
+    while (start < mix.size())
+    {
+        size_t end = mix.find(',', start);
+        if (end == std::string::npos)
+        {
+            end = mix.size();
+        }
+
+        std::string entry = mix.substr(start, end - start);
+        size_t equals = entry.find('=');
+        if (equals == std::string::npos)
+        {
+            return false;
+        }
+
+        auto type = std::find(c_scan_types.begin(), c_scan_types.end(), entry.substr(0, equals));
+        if (type == c_scan_types.end())
+        {
+            return false;
+        }
+        weights[type - c_scan_types.begin()] = std::stod(entry.substr(equals + 1));
+
+        start = end + 1;
+    }
+
+    return std::any_of(weights.begin(), weights.end(), [](double weight) { return weight > 0; });
+}
+
+std::string get_scan_json(const std::string& scan_type, uint64_t person_id, uint64_t room_id)
+{
+    std::string payload = "{\"scan_type\":\"" + scan_type + "\",\"person_id\":" + std::to_string(person_id);
+    payload += ",\"room_id\":" + (room_id ? std::to_string(room_id) : std::string("null"));
+    payload += ",\"building_id\":" + std::to_string(c_building_id) + "}";
+    return payload;
+}
+
+void populate_site(uint64_t person_count, uint64_t room_count)
+{
+    truncate_all_tables();
+
+    gaia::db::begin_transaction();
+    helpers::set_time(480);
+    building_t building = add_building(c_building_id, "Bench Building");
+    for (uint64_t i = 0; i < room_count; i++)
+    {
+        add_room(c_first_room_id + i, "Room " + std::to_string(i), person_count, building);
+    }
+    for (uint64_t person_id = 1; person_id <= person_count; person_id++)
+    {
+        add_person(person_id, "Employee " + std::to_string(person_id), true, false, false);
+    }
+
+    gaia::db::commit_transaction();
+}
+
+// Waits until no scan is in flight, or the timeout expires.
+bool drain(std::chrono::milliseconds timeout)
+{
+    auto deadline = steady_clock::now() + timeout;
+    while (steady_clock::now() < deadline)
+    {
+        bool is_idle = std::none_of(
+            g_in_flight_since.begin(), g_in_flight_since.end(),
+            [](const std::atomic<int64_t>& since) { return since != 0; });
+        {
+            std::lock_guard lock(g_stranger_lock);
+            is_idle = is_idle && g_next_stranger_response == g_stranger_scans.size();
+        }
+        if (is_idle)
+        {
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return false;
+}
+
+size_t count_in_flight()
+{
+    size_t in_flight = std::count_if(
+        g_in_flight_since.begin(), g_in_flight_since.end(),
+        [](const std::atomic<int64_t>& since) { return since != 0; });
+    std::lock_guard lock(g_stranger_lock);
+    return in_flight + g_stranger_scans.size() - g_next_stranger_response;
+}
+
+double get_percentile_us(const std::vector<int64_t>& sorted_latencies_ns, double percentile)
+{
+    if (sorted_latencies_ns.empty())
+    {
+        return 0;
+    }
+    size_t index = std::min(
+        sorted_latencies_ns.size() - 1, static_cast<size_t>(percentile * sorted_latencies_ns.size()));
+    return sorted_latencies_ns[index] / 1000.0;
+}
+
+int main(int argc, char* argv[])
+{
+    config::init(argc, argv);
+    uint64_t person_count = std::max<uint64_t>(config::get_uint_option("--persons", 1000), 1);
+    uint64_t room_count = std::max<uint64_t>(config::get_uint_option("--rooms", 20), 1);
+    uint64_t scan_count = config::get_uint_option("--scans", 100000);
+    uint64_t rate = config::get_uint_option("--rate", 0);
+    uint64_t burst_size = std::max<uint64_t>(config::get_uint_option("--burst-size", 1), 1);
+    std::chrono::milliseconds drain_timeout(config::get_uint_option("--drain-timeout-ms", 10000));
+
+    std::vector<double> weights;
+    if (!parse_mix(config::get_option("--mix", c_default_mix), weights))
+    {
+        std::cerr << "Invalid --mix; expected type=weight pairs using:";
+        for (const std::string& scan_type : c_scan_types)
+        {
+            std::cerr << " " << scan_type;
+        }
+        std::cerr << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    gaia::system::initialize();
+    communication::set_publish_sink(publish_sink);
+
+    std::cout << "Populating " << person_count << " persons and " << room_count << " rooms..." << std::endl;
+    populate_site(person_count, room_count);
+    g_in_flight_since = std::vector<std::atomic<int64_t>>(person_count);
+
+    if (!start_workers(false))
+    {
+        return EXIT_FAILURE;
+    }
+
+    // Warm-up: badge everyone in so that their face scans are admitted.
+    for (uint64_t person_id = 1; person_id <= person_count; person_id++)
+    {
+        g_in_flight_since[person_id - 1] = now_ns();
+        ingest::enqueue(c_scan_topic, get_scan_json("badge", person_id, 0));
+    }
+    if (!drain(drain_timeout))
+    {
+        std::cerr << "Warm-up did not complete; " << count_in_flight() << " scans unanswered." << std::endl;
+    }
+    {
+        std::lock_guard lock(g_latency_lock);
+        g_latencies_ns.clear();
+    }
+
+    std::mt19937_64 random_engine(42);
+    std::discrete_distribution<size_t> pick_type(weights.begin(), weights.end());
+    std::uniform_int_distribution<uint64_t> pick_room(0, room_count - 1);
+    std::vector<bool> is_in_room(person_count, false);
+    std::vector<uint64_t> sent_by_type(c_scan_types.size(), 0);
+
+    std::cout << "Sending " << scan_count << " scans..." << std::endl;
+    auto start_time = steady_clock::now();
+    auto next_burst_time = start_time;
+    auto burst_period = rate ? std::chrono::nanoseconds(1000000000ull * burst_size / rate) : std::chrono::nanoseconds(0);
+    uint64_t next_person_index = 0;
+
+    for (uint64_t sent = 0; sent < scan_count;)
+    {
+        if (rate)
+        {
+            std::this_thread::sleep_until(next_burst_time);
+            next_burst_time += burst_period;
+        }
+
+        for (uint64_t in_burst = 0; in_burst < burst_size && sent < scan_count; in_burst++, sent++)
+        {
+            size_t type_index = pick_type(random_engine);
+            const std::string* scan_type = &c_scan_types[type_index];
+
+            if (*scan_type == "stranger")
+            {
+                {
+                    std::lock_guard lock(g_stranger_lock);
+                    g_stranger_scans.push_back(now_ns());
+                }
+                ingest::enqueue(c_scan_topic, get_scan_json("face", c_first_stranger_id + sent, c_first_room_id));
+                sent_by_type[type_index]++;
+                continue;
+            }
+
+            // Find the next person without a scan in flight.
+            while (g_in_flight_since[next_person_index] != 0)
+            {
+                next_person_index = (next_person_index + 1) % person_count;
+                std::this_thread::yield();
+            }
+            uint64_t person_index = next_person_index;
+            next_person_index = (next_person_index + 1) % person_count;
+
+            uint64_t room_id = 0;
+            if (*scan_type == "leaving" && !is_in_room[person_index])
+            {
+                type_index = std::find(c_scan_types.begin(), c_scan_types.end(), "face") - c_scan_types.begin();
+                scan_type = &c_scan_types[type_index];
+            }
+            if (*scan_type == "face")
+            {
+                room_id = c_first_room_id + pick_room(random_engine);
+                is_in_room[person_index] = true;
+            }
+            else if (*scan_type == "leaving")
+            {
+                room_id = c_first_room_id;
+                is_in_room[person_index] = false;
+            }
+
+            g_in_flight_since[person_index] = now_ns();
+            ingest::enqueue(c_scan_topic, get_scan_json(*scan_type, person_index + 1, room_id));
+            sent_by_type[type_index]++;
+        }
+    }
+
+    bool is_drained = drain(drain_timeout);
+    std::chrono::duration<double> elapsed = steady_clock::now() - start_time;
+
+    stop_workers();
+    gaia::system::shutdown();
+    stop_rule_outputs();
+
+    std::vector<int64_t> latencies_ns;
+    {
+        std::lock_guard lock(g_latency_lock);
+        latencies_ns = g_latencies_ns;
+    }
+    std::sort(latencies_ns.begin(), latencies_ns.end());
+
+    std::cout << std::endl << "Scans sent:";
+    for (size_t i = 0; i < c_scan_types.size(); i++)
+    {
+        if (sent_by_type[i])
+        {
+            std::cout << " " << c_scan_types[i] << "=" << sent_by_type[i];
+        }
+    }
+    std::cout << std::endl;
+    std::cout << "Responses:    " << latencies_ns.size() << std::endl;
+    if (!is_drained)
+    {
+        std::cout << "Unanswered:   " << count_in_flight() << std::endl;
+    }
+    std::cout << "Elapsed:      " << elapsed.count() << " s" << std::endl;
+    std::cout << "Throughput:   " << scan_count / elapsed.count() << " scans/s" << std::endl;
+    std::cout << "Latency p50:  " << get_percentile_us(latencies_ns, 0.50) << " us" << std::endl;
+    std::cout << "Latency p99:  " << get_percentile_us(latencies_ns, 0.99) << " us" << std::endl;
+    std::cout << "Latency p999: " << get_percentile_us(latencies_ns, 0.999) << " us" << std::endl;
+    if (!latencies_ns.empty())
+    {
+        std::cout << "Latency max:  " << latencies_ns.back() / 1000.0 << " us" << std::endl;
+    }
+
+    return is_drained ? EXIT_SUCCESS : EXIT_FAILURE;
+}
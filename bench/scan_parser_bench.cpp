@@ -0,0 +1,137 @@
+/////////////////////////////////////////////
+// Copyright (c) Gaia Platform LLC
+// All rights reserved.
+/////////////////////////////////////////////
+
+// Compares decoding "access_control/scan" payloads with scan_parser::parse()
+// against the original path: json::parse() followed by a chain of string
+// comparisons on scan_type.
+//
+// Usage: scan_parser_bench [iterations]
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "json.hpp"
+#include "scan_message.hpp"
+#include "scan_parser.hpp"
+
+using json = nlohmann::json;
+using namespace enums::scan_table;
+
+const std::vector<std::string> c_payloads = {
+    R"({"scan_type":"badge","person_id":1,"room_id":null,"building_id":10})",
+    R"({"scan_type":"vehicle_entering","person_id":2,"room_id":null,"building_id":10})",
+    R"({"scan_type":"vehicle_departing","person_id":2,"room_id":null,"building_id":10})",
+    R"({"scan_type":"joining_wifi","person_id":1,"room_id":null,"building_id":10})",
+    R"({"scan_type":"leaving_wifi","person_id":1,"room_id":null,"building_id":10})",
+    R"({"scan_type":"face","person_id":1,"room_id":102,"building_id":10})",
+    R"({"scan_type":"leaving","person_id":1,"room_id":102,"building_id":10})",
+};
+
+scan_message_t decode_with_dom(const std::string& payload)
+{
+    json j = json::parse(payload);
+
+    scan_message_t scan{};
+    if (j["scan_type"] == "badge")
+    {
+        scan.scan_type = e_scan_type::badge;
+    }
+    else if (j["scan_type"] == "vehicle_entering")
+    {
+        scan.scan_type = e_scan_type::vehicle_entering;
+    }
+    else if (j["scan_type"] == "vehicle_departing")
+    {
+        scan.scan_type = e_scan_type::vehicle_departing;
+    }
+    else if (j["scan_type"] == "joining_wifi")
+    {
+        scan.scan_type = e_scan_type::joining_wifi;
+    }
+    else if (j["scan_type"] == "leaving_wifi")
+    {
+        scan.scan_type = e_scan_type::leaving_wifi;
+    }
+    else if (j["scan_type"] == "face")
+    {
+        scan.scan_type = e_scan_type::face;
+    }
+    else if (j["scan_type"] == "leaving")
+    {
+        scan.scan_type = e_scan_type::leaving;
+    }
+
+    scan.person_id = j["person_id"];
+    if (!j["room_id"].is_null())
+    {
+        scan.has_room_id = true;
+        scan.room_id = j["room_id"];
+    }
+    if (!j["building_id"].is_null())
+    {
+        scan.has_building_id = true;
+        scan.building_id = j["building_id"];
+    }
+
+    return scan;
+}
+
+scan_message_t decode_with_scan_parser(const std::string& payload)
+{
+    scan_message_t scan;
+    if (!scan_parser::parse(payload, scan))
+    {
+        std::cerr << "Fast path rejected payload: " << payload << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    return scan;
+}
+
+template <typename T_decoder>
+double run(const char* name, uint64_t iterations, T_decoder decoder)
+{
+    // Folded into the output so the decoding cannot be optimized away.
+    uint64_t checksum = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < iterations; i++)
+    {
+        scan_message_t scan = decoder(c_payloads[i % c_payloads.size()]);
+        checksum += scan.scan_type + scan.person_id + scan.room_id + scan.building_id;
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+    double ns_per_scan = elapsed.count() / iterations;
+    std::cout << name << ": " << ns_per_scan << " ns/scan (checksum " << checksum << ")" << std::endl;
+    return ns_per_scan;
+}
+
+int main(int argc, char* argv[])
+{
+    uint64_t iterations = argc > 1 ? std::stoull(argv[1]) : 1000000;
+
+    // Both decoders must agree before their speed is worth comparing.
+    for (const std::string& payload : c_payloads)
+    {
+        scan_message_t expected = decode_with_dom(payload);
+        scan_message_t actual = decode_with_scan_parser(payload);
+        if (expected.scan_type != actual.scan_type || expected.person_id != actual.person_id
+            || expected.has_room_id != actual.has_room_id || expected.room_id != actual.room_id
+            || expected.has_building_id != actual.has_building_id || expected.building_id != actual.building_id)
+        {
+            std::cerr << "Decoders disagree on payload: " << payload << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    double dom_ns = run("json::parse + string compares", iterations, decode_with_dom);
+    double fast_ns = run("scan_parser::parse", iterations, decode_with_scan_parser);
+    std::cout << "Speedup: " << dom_ns / fast_ns << "x" << std::endl;
+
+    return EXIT_SUCCESS;
+}
@@ -18,4 +18,9 @@ void not_this_building(uint64_t person_id, std::string building_name);
 void not_this_room(
     uint64_t person_id, std::string room_name, std::string building_name);
 
+void room_at_capacity(
+    uint64_t person_id, std::string room_name, std::string building_name);
+
+void ingest_overloaded(uint64_t rejected_count);
+
 } // namespace actions
\ No newline at end of file
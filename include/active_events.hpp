@@ -0,0 +1,53 @@
+/////////////////////////////////////////////
+// Copyright (c) Gaia Platform LLC
+// All rights reserved.
+/////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+
+#include "gaia_access_control.h"
+
+// The set of events under way at the current application time, kept per
+// registered person and per room, so that admission checks are a lookup
+// rather than a comparison of every registration's window with the clock.
+//
+// Events only start or stop at their start_timestamp and end_timestamp, so
+// each event is scheduled on a time_scheduler_t and flipped in or out of
+// the set when helpers::set_time() crosses one of those boundaries. As with
+// helpers::time_is_between(), an event is active from start_timestamp up
+// to and including end_timestamp. If the clock moves backward, the set is
+// rebuilt from the events' windows.
+//
+// A person is tracked from add_person() on. Lookups for people created
+// elsewhere, such as strangers, fall back to the database.
+namespace active_events
+{
+
+void add_person(gaia::common::gaia_id_t person_id);
+
+// room_id is c_invalid_gaia_id for an event not held in a room.
+void add_event(
+    gaia::common::gaia_id_t event_id, gaia::common::gaia_id_t room_id,
+    uint64_t start_timestamp, uint64_t end_timestamp);
+
+void add_registration(gaia::common::gaia_id_t person_id, gaia::common::gaia_id_t event_id);
+
+// Reschedules an event whose window or room changed.
+void update_event(
+    gaia::common::gaia_id_t event_id, gaia::common::gaia_id_t room_id,
+    uint64_t start_timestamp, uint64_t end_timestamp);
+
+// Called by helpers::set_time().
+void set_time(uint64_t time);
+
+// Sets has_event to whether the person has an active event, in the given
+// room or in any room if room_id is c_invalid_gaia_id. Returns false if
+// the person is not tracked.
+bool find_active_event(gaia::common::gaia_id_t person_id, gaia::common::gaia_id_t room_id, bool& has_event);
+
+// Call whenever the tables are wiped.
+void clear();
+
+} // namespace active_events
@@ -0,0 +1,38 @@
+/////////////////////////////////////////////
+// Copyright (c) Gaia Platform LLC
+// All rights reserved.
+/////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+
+#include "gaia_access_control.h"
+
+// Keeps person.admissible in step with the clock.
+//
+// A credentialed person is admissible while the current time is within
+// [entry_time, leave_time]. Each person's next window boundary is kept on
+// a time_scheduler_t, and when helpers::set_time() crosses it, exactly the
+// people concerned are re-evaluated: admissible is set when the window
+// opens and cleared when it closes. If the clock moves backward, everyone
+// whose window state differs between the old and the new time is
+// re-evaluated.
+namespace admission_scheduler
+{
+
+void add_person(gaia::common::gaia_id_t person_id, uint64_t entry_time, uint64_t leave_time);
+
+// Reschedules a person whose window changed; cheap when it did not.
+void update_person(gaia::common::gaia_id_t person_id, uint64_t entry_time, uint64_t leave_time);
+
+// Called by helpers::set_time(). Updates the people whose window opened or
+// closed in a transaction of its own. If the caller has a transaction open,
+// or the update cannot be committed, those people are updated by the next
+// call made outside a transaction instead.
+void set_time(uint64_t time);
+
+// Call whenever the tables are wiped.
+void clear();
+
+} // namespace admission_scheduler
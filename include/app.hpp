@@ -0,0 +1,87 @@
+/////////////////////////////////////////////
+// Copyright (c) Gaia Platform LLC
+// All rights reserved.
+/////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "gaia_access_control.h"
+
+#include "scan_message.hpp"
+
+// The access control application, minus its entry point, so that it can
+// also be driven by the benchmark and other harnesses.
+
+// The admission window of people added without one.
+constexpr uint64_t c_default_entry_time = 0;
+constexpr uint64_t c_default_leave_time = 100000;
+
+// Table population. Must be called inside a transaction.
+gaia::access_control::event_t add_event(
+    std::string name, uint64_t start_timestamp,
+    uint64_t end_timestamp, gaia::access_control::room_t room);
+gaia::access_control::registration_t add_registration(
+    gaia::access_control::person_t person, gaia::access_control::event_t occasion);
+gaia::access_control::room_t add_room(
+    uint64_t room_id, std::string room_name,
+    uint32_t capacity, gaia::access_control::building_t building);
+gaia::access_control::person_t add_person(
+    uint64_t person_id, std::string first_name,
+    bool employee, bool visitor, bool stranger);
+// Inserts a person whose row the caller filled in, and registers it like
+// add_person() does.
+gaia::access_control::person_t insert_person(gaia::access_control::person_writer& person_w);
+gaia::access_control::building_t add_building(uint64_t building_id, std::string name);
+
+void populate_all_tables();
+
+// Delete every row of every table and empty the in-memory indexes, in a
+// single pass over each table. clear_all_tables() must be called inside a
+// transaction. truncate_all_tables() must be called outside one, while
+// nothing else writes; it commits every few thousand rows, so it scales to
+// large databases. It first commits the removal of the schema marker on its
+// own, so a crash part-way leaves tables that --startup keep will not reuse.
+void clear_all_tables();
+void truncate_all_tables();
+
+// Persisted state. Must be called inside a transaction.
+//
+// has_current_schema() tells whether the tables hold data written under
+// the current schema version, and mark_schema_current() records that they
+// do once they are fully populated. rebuild_indexes() restores the clock
+// and refills the in-memory indexes from the tables in a single pass, so
+// that persisted data can be used without clearing and repopulating it.
+bool has_current_schema();
+void mark_schema_current();
+void rebuild_indexes();
+
+// Lookups by external ID. Must be called inside a transaction.
+bool get_person(uint64_t person_id, gaia::access_control::person_t& person);
+bool get_room(uint64_t room_id, gaia::access_control::room_t& room);
+bool get_building(uint64_t building_id, gaia::access_control::building_t& building);
+
+// Inserts a batch of scans in one transaction. Returns false if the batch
+// could not be committed; its scans are then counted as dropped.
+bool add_scans(const std::vector<scan_message_t>& scans);
+
+// Handles one incoming message; see communication::message_callback_t.
+void message_callback(const std::string& topic, const std::string& payload);
+
+// Starts the scan workers, the ingest queue, the UI delta publisher and the
+// publish coalescer, as configured on the command line. Returns false on
+// invalid options. When replaying a trace, one scan worker and blocking
+// backpressure are used whatever the options say, so that no message is
+// dropped or reordered.
+bool start_workers(bool is_replaying);
+
+// Drains and stops everything start_workers() started, except what
+// stop_rule_outputs() stops.
+void stop_workers();
+
+// Stops the audit log and the publish coalescer, which the rules write to.
+// Call after gaia::system::shutdown(), once no rule is running anymore.
+void stop_rule_outputs();
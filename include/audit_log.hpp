@@ -0,0 +1,48 @@
+/////////////////////////////////////////////
+// Copyright (c) Gaia Platform LLC
+// All rights reserved.
+/////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "gaia_access_control.h"
+
+#include "audit_record.hpp"
+
+// Append-only audit trail of scans and access decisions, kept on local disk
+// instead of in the database. The format is described in audit_record.hpp.
+//
+// Recording copies the record into a buffer and never waits for the disk. A
+// writer thread appends everything buffered so far and syncs it with one
+// fdatasync() call, so records written during a sync share the next one.
+// Once a segment holds the configured number of records, the writer moves on
+// to a new segment. Every start opens a new segment.
+//
+// Decisions are recorded from rule transactions, as soon as the rule makes
+// them, and are not withdrawn if that transaction then aborts. Each one
+// carries the rule and rule invocation that made it, so that the decisions
+// of attempts that were retried can be told apart from the final ones; see
+// audit_record.hpp.
+namespace audit_log
+{
+
+// Returns false if the directory cannot be created or written to.
+bool start(const std::string& directory, uint64_t segment_record_count);
+
+// Writes and syncs everything recorded so far.
+void stop();
+
+// Appends one record. Does nothing unless started.
+void record(
+    outcome_t outcome, gaia::common::gaia_id_t scan_id, uint8_t scan_type,
+    uint64_t person_id, uint64_t room_id, uint64_t building_id);
+
+// Records the outcome of a scan, reading its person, room and building,
+// along with the rule open on this thread. Must be called inside a
+// transaction.
+void record_decision(gaia::common::gaia_id_t scan_id, outcome_t outcome);
+
+} // namespace audit_log
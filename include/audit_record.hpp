@@ -0,0 +1,90 @@
+/////////////////////////////////////////////
+// Copyright (c) Gaia Platform LLC
+// All rights reserved.
+/////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+
+// On-disk format of the audit log, shared by the writer in audit_log.hpp and
+// by the audit_query tool.
+//
+// The log is a directory of segment files named audit-<sequence>.log, with
+// a zero-padded sequence that grows by one for every new segment. A
+// segment is a plain array of audit_record_t in native (little-endian)
+// byte order, with no header, so record i is at offset 64 * i. Bytes past
+// the last whole record, left by a crash while writing, are ignored.
+//
+// Decisions are recorded as rules make them, so a rule attempt that is
+// rolled back and retried leaves the decisions of both attempts. Each
+// decision names the rule and the rule invocation that made it; of the
+// decisions about a scan by one rule, only those of the highest invocation
+// ID are final.
+namespace audit_log
+{
+
+// The rule of records that no rule made, such as "received".
+constexpr uint8_t c_no_rule = 0xFF;
+
+enum class outcome_t : uint8_t
+{
+    // The scan was committed; the decisions follow in separate records.
+    received,
+    admitted_to_room,
+    admitted_to_building,
+    stranger_detected,
+    base_credentials_required,
+    no_entry_right_now,
+    not_this_building,
+    not_this_room,
+    room_at_capacity,
+    count
+};
+
+constexpr const char* c_outcome_names[] = {
+    "received",
+    "admitted_to_room",
+    "admitted_to_building",
+    "stranger_detected",
+    "base_credentials_required",
+    "no_entry_right_now",
+    "not_this_building",
+    "not_this_room",
+    "room_at_capacity",
+};
+
+static_assert(sizeof(c_outcome_names) / sizeof(c_outcome_names[0]) == static_cast<size_t>(outcome_t::count));
+
+struct audit_record_t
+{
+    // Wall-clock time the record was written, in nanoseconds since the Unix
+    // epoch, and the application clock at that moment.
+    uint64_t wall_time_ns;
+    uint64_t app_time;
+
+    // External IDs; 0 when the scan did not name one.
+    uint64_t person_id;
+    uint64_t room_id;
+    uint64_t building_id;
+
+    // The scan row's gaia_id, which ties a scan's decisions to its
+    // "received" record.
+    uint64_t scan_id;
+
+    // The rule_profiler invocation ID of the rule that made the decision;
+    // 0 when rule is c_no_rule. IDs restart from 1 with every run.
+    uint64_t invocation_id;
+
+    uint8_t scan_type;
+    outcome_t outcome;
+
+    // A rule_profiler::rule_t, or c_no_rule.
+    uint8_t rule;
+
+    uint8_t reserved[5];
+};
+
+static_assert(sizeof(audit_record_t) == 64);
+
+} // namespace audit_log
@@ -0,0 +1,132 @@
+/////////////////////////////////////////////
+// Copyright (c) Gaia Platform LLC
+// All rights reserved.
+/////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Bounded lock-free queue (Dmitry Vyukov's array-based algorithm).
+//
+// Any number of threads may push and pop concurrently. Each cell carries a
+// sequence number that tells producers and consumers whose turn it is, so
+// neither side ever takes a lock. The capacity is rounded up to a power of
+// two.
+template <typename T>
+class bounded_queue_t
+{
+public:
+    explicit bounded_queue_t(size_t capacity)
+    {
+        size_t rounded_capacity = 2;
+        while (rounded_capacity < capacity)
+        {
+            rounded_capacity <<= 1;
+        }
+
+        m_mask = rounded_capacity - 1;
+        m_cells = std::make_unique<cell_t[]>(rounded_capacity);
+        for (size_t i = 0; i < rounded_capacity; i++)
+        {
+            m_cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    bounded_queue_t(const bounded_queue_t&) = delete;
+    bounded_queue_t& operator=(const bounded_queue_t&) = delete;
+
+    // Returns false if the queue is full.
+    bool try_push(T&& value)
+    {
+        size_t position = m_enqueue_position.load(std::memory_order_relaxed);
+        cell_t* cell;
+        while (true)
+        {
+            cell = &m_cells[position & m_mask];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+            if (difference == 0)
+            {
+                if (m_enqueue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (difference < 0)
+            {
+                return false;
+            }
+            else
+            {
+                position = m_enqueue_position.load(std::memory_order_relaxed);
+            }
+        }
+
+        cell->value = std::move(value);
+        cell->sequence.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Returns false if the queue is empty.
+    bool try_pop(T& value)
+    {
+        size_t position = m_dequeue_position.load(std::memory_order_relaxed);
+        cell_t* cell;
+        while (true)
+        {
+            cell = &m_cells[position & m_mask];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position + 1);
+            if (difference == 0)
+            {
+                if (m_dequeue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (difference < 0)
+            {
+                return false;
+            }
+            else
+            {
+                position = m_dequeue_position.load(std::memory_order_relaxed);
+            }
+        }
+
+        value = std::move(cell->value);
+        cell->sequence.store(position + m_mask + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t capacity() const
+    {
+        return m_mask + 1;
+    }
+
+    // Only exact when no push or pop is in progress.
+    size_t size() const
+    {
+        size_t enqueue_position = m_enqueue_position.load(std::memory_order_relaxed);
+        size_t dequeue_position = m_dequeue_position.load(std::memory_order_relaxed);
+        return enqueue_position > dequeue_position ? enqueue_position - dequeue_position : 0;
+    }
+
+private:
+    struct cell_t
+    {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    std::unique_ptr<cell_t[]> m_cells;
+    size_t m_mask;
+
+    // Kept on separate cache lines so producers and consumers don't contend.
+    alignas(64) std::atomic<size_t> m_enqueue_position{0};
+    alignas(64) std::atomic<size_t> m_dequeue_position{0};
+};
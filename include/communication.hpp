@@ -5,10 +5,14 @@
 
 #pragma once
 
+#include <chrono>
+#include <memory>
 #include <string>
 
 #include "gaia_access_control.h"
 
+#include "transport.hpp"
+
 namespace gaia
 {
 namespace access_control
@@ -16,14 +20,30 @@ namespace access_control
 namespace communication
 {
 
-typedef void (*message_callback_t)(const std::string& topic, const std::string& payload);
-
 std::string get_uuid();
 
+// Chooses the transport from the command line: MQTT by default, or the
+// loopback transport with "--transport loopback". Call config::init() first.
 bool init(int argc, char* argv[]);
+
+// Replaces the transport chosen by init(), e.g. with a loopback_transport_t
+// that captures published messages. Call before anything is published.
+void set_transport(std::unique_ptr<transport_t> transport);
+
+// Publishes through a loopback_transport_t that hands every published
+// message to sink, e.g. to capture them in-process. Call before anything is
+// published.
+void set_publish_sink(publish_sink_t sink);
+
 void connect(message_callback_t callback, const std::string& init_msg);
 void publish_message(const std::string& topic, const std::string& payload);
 
+// Routes publish_message() through a publish_coalescer_t with the given
+// window, until stopped. Safe to call while rules publish; messages
+// published during or after the stop are sent immediately.
+void start_publish_coalescing(std::chrono::microseconds window);
+void stop_publish_coalescing();
+
 } // namespace communication
 } // namespace access_control
 } // namespace gaia
@@ -0,0 +1,25 @@
+/////////////////////////////////////////////
+// Copyright (c) Gaia Platform LLC
+// All rights reserved.
+/////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Optional command-line settings shared by the application modules.
+// Options take the form "--name value"; anything not given falls back to
+// the default supplied by the caller.
+namespace config
+{
+
+void init(int argc, char* argv[]);
+
+bool option_exists(const std::string& option);
+
+std::string get_option(const std::string& option, const std::string& default_value);
+
+uint64_t get_uint_option(const std::string& option, uint64_t default_value);
+
+} // namespace config
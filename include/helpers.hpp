@@ -34,6 +34,14 @@ void disconnect_person_from_building(gaia::common::gaia_id_t person_id);
 
 void delete_their_room_permissions(gaia::common::gaia_id_t person_id);
 
+// Counts the person into the room the scan was taken in, unless the room is
+// at capacity. Returns false, and counts nothing, if the person cannot
+// enter it. A room with capacity 0 has no limit, and people already inside
+// are never turned away. Scans outside a room always succeed.
+bool claim_room_place(
+    gaia::common::gaia_id_t person_id,
+    gaia::common::gaia_id_t scan_id);
+
 void let_them_in(
     gaia::common::gaia_id_t person_id,
     gaia::common::gaia_id_t scan_id);
@@ -0,0 +1,46 @@
+/////////////////////////////////////////////
+// Copyright (c) Gaia Platform LLC
+// All rights reserved.
+/////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <shared_mutex>
+#include <unordered_map>
+
+#include "gaia_access_control.h"
+
+namespace id_index
+{
+
+// Unique in-memory index from an external numeric ID (person_id, room_id,
+// building_id) to the gaia_id_t of the row carrying it.
+//
+// The index is authoritative: every row that has an external ID must be
+// added through insert() when it is created and removed through erase()
+// (or clear()) when it is deleted. Lookups never fall back to a table scan.
+class id_map_t
+{
+public:
+    bool find(uint64_t external_id, gaia::common::gaia_id_t& gaia_id) const;
+
+    void insert(uint64_t external_id, gaia::common::gaia_id_t gaia_id);
+    void erase(uint64_t external_id);
+    void clear();
+
+    size_t size() const;
+
+private:
+    mutable std::shared_mutex m_lock;
+    std::unordered_map<uint64_t, gaia::common::gaia_id_t> m_map;
+};
+
+id_map_t& persons();
+id_map_t& rooms();
+id_map_t& buildings();
+
+// Empties all three indexes. Call whenever the tables are wiped.
+void clear_all();
+
+} // namespace id_index
@@ -0,0 +1,61 @@
+/////////////////////////////////////////////
+// Copyright (c) Gaia Platform LLC
+// All rights reserved.
+/////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "communication.hpp"
+
+// Decouples the MQTT event loop from the database.
+//
+// enqueue() is handed to communication::connect() as the message callback:
+// it only copies the message into a bounded lock-free queue. A dedicated
+// worker thread, with its own database session, pops the messages in order
+// and passes them to the real message handler.
+namespace ingest
+{
+
+// What enqueue() does when the queue is full.
+enum class backpressure_policy_t
+{
+    // Wait for the worker to make room. Nothing is lost, but the MQTT
+    // event loop stalls.
+    block,
+    // Discard the oldest queued message to make room for the new one.
+    drop_oldest,
+    // Discard the new message and raise an alert.
+    reject,
+};
+
+bool parse_backpressure_policy(const std::string& name, backpressure_policy_t& policy);
+
+struct stats_t
+{
+    uint64_t enqueued_count;
+    uint64_t processed_count;
+    uint64_t dropped_count;
+    uint64_t rejected_count;
+    // Messages whose handler threw; they count as processed too.
+    uint64_t failed_count;
+    size_t depth;
+    size_t max_depth;
+    size_t capacity;
+};
+
+void start(
+    gaia::access_control::communication::message_callback_t handler,
+    size_t capacity,
+    backpressure_policy_t policy);
+
+// Processes whatever is still queued and joins the worker.
+void stop();
+
+void enqueue(const std::string& topic, const std::string& payload);
+
+stats_t get_stats();
+
+} // namespace ingest
@@ -0,0 +1,57 @@
+/////////////////////////////////////////////
+// Copyright (c) Gaia Platform LLC
+// All rights reserved.
+/////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Streams compact JSON into a reusable buffer.
+//
+// The output is byte-for-byte what nlohmann::json::dump() produces for the
+// same document, provided that the caller emits object keys in sorted
+// order (nlohmann::json stores objects in a std::map). After clear() the
+// buffer keeps its capacity, so steady-state writes do not allocate.
+class json_writer_t
+{
+public:
+    void clear();
+
+    const std::string& str() const
+    {
+        return m_buffer;
+    }
+
+    void begin_object();
+    void end_object();
+    void begin_array();
+    void end_array();
+
+    void key(std::string_view name);
+
+    void value(const char* value);
+    void value(std::string_view value);
+    void value(uint64_t value);
+    void value(bool value);
+    void null();
+
+    // Appends an already serialized JSON value, such as a cached fragment.
+    void raw(std::string_view json);
+
+private:
+    void begin_value();
+    void write_string(std::string_view value);
+
+private:
+    std::string m_buffer;
+
+    // One entry per open object or array: whether it already has an element.
+    std::vector<bool> m_has_elements;
+
+    // Set after a key, so the value that follows is not preceded by a comma.
+    bool m_after_key = false;
+};
@@ -0,0 +1,54 @@
+/////////////////////////////////////////////
+// Copyright (c) Gaia Platform LLC
+// All rights reserved.
+/////////////////////////////////////////////
+
+#pragma once
+
+#include <mutex>
+#include <string>
+
+#include "transport.hpp"
+
+namespace gaia
+{
+namespace access_control
+{
+namespace communication
+{
+
+// An in-process stand-in for the MQTT broker, for running without network
+// access and for measuring the rule pipeline without WAN latency.
+//
+// run() reads "<topic> <payload>" lines from stdin until end of input and
+// delivers each as if it had been published to this client, e.g.
+//
+//     access_control/time 480
+//     access_control/scan {"scan_type":"badge","person_id":1,"building_id":1}
+//
+// Published messages go to the sink passed to the constructor, or are
+// written to stdout in the same "<topic> <payload>" form without one.
+class loopback_transport_t : public transport_t
+{
+public:
+    explicit loopback_transport_t(publish_sink_t sink = nullptr);
+
+    bool connect(const std::string& client_id, message_callback_t callback) override;
+    void run() override;
+    void publish(const std::string& topic, const std::string& payload) override;
+    void disconnect() override;
+
+    // Delivers a message as if it had been received; topic is relative, as
+    // for publish().
+    void inject(const std::string& topic, const std::string& payload);
+
+private:
+    const publish_sink_t m_sink;
+    std::string m_client_id;
+    message_callback_t m_callback = nullptr;
+    std::mutex m_output_lock;
+};
+
+} // namespace communication
+} // namespace access_control
+} // namespace gaia
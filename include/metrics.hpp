@@ -0,0 +1,129 @@
+/////////////////////////////////////////////
+// Copyright (c) Gaia Platform LLC
+// All rights reserved.
+/////////////////////////////////////////////
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include "enums.hpp"
+
+// Where the time goes in the scan pipeline, and how much work it does.
+//
+// Every stage has a histogram of its durations and every event a counter.
+// Recording is a few relaxed atomic increments, so it is always on. A
+// background exporter periodically publishes a snapshot on
+// "access_control/metrics" and rewrites a text dump.
+namespace metrics
+{
+
+enum class stage_t : size_t
+{
+    // Decoding a scan payload.
+    parse,
+    // Resolving a scan's person, room and building.
+    lookup,
+    // Committing a batch of scans.
+    commit,
+    // Running a rule of access_control_ruleset.
+    rules,
+    // Handing a message to the transport.
+    publish,
+    count
+};
+
+enum class counter_t : size_t
+{
+    strangers_detected,
+    alerts_no_eligible_events,
+    alerts_base_credentials_required,
+    alerts_no_entry_right_now,
+    alerts_not_this_building,
+    alerts_not_this_room,
+    alerts_room_at_capacity,
+    alerts_ingest_overloaded,
+    publishes,
+    publish_failures,
+    scans_expired,
+    scans_dropped,
+    count
+};
+
+constexpr size_t c_scan_type_count = enums::scan_table::e_scan_type::leaving + 1;
+
+// A log-linear histogram of nanosecond durations, in the style of HDR
+// histograms: every power of two is split into 8 buckets, so any recorded
+// value is reported within 12.5%. Lock-free; snapshots taken while values
+// are being recorded may be off by those in flight.
+class histogram_t
+{
+public:
+    void record(uint64_t value);
+
+    uint64_t get_count() const;
+    uint64_t get_sum() const;
+    uint64_t get_max() const;
+
+    // Upper bound of the bucket holding the given quantile (0 to 1).
+    uint64_t get_percentile(double quantile) const;
+
+private:
+    static constexpr size_t c_sub_bucket_bits = 3;
+    static constexpr size_t c_sub_bucket_count = 1 << c_sub_bucket_bits;
+    static constexpr size_t c_bucket_count = (64 - c_sub_bucket_bits + 1) * c_sub_bucket_count;
+
+    static size_t get_bucket_index(uint64_t value);
+    static uint64_t get_bucket_upper_bound(size_t index);
+
+private:
+    std::array<std::atomic<uint64_t>, c_bucket_count> m_buckets{};
+    std::atomic<uint64_t> m_count{0};
+    std::atomic<uint64_t> m_sum{0};
+    std::atomic<uint64_t> m_max{0};
+};
+
+void record_stage(stage_t stage, std::chrono::nanoseconds duration);
+void count(counter_t counter, uint64_t amount = 1);
+void count_scan(enums::scan_table::e_scan_type scan_type);
+
+const histogram_t& get_stage_histogram(stage_t stage);
+uint64_t get_count(counter_t counter);
+
+// Records the time from construction to destruction as one sample of a
+// stage.
+class stage_timer_t
+{
+public:
+    explicit stage_timer_t(stage_t stage)
+        : m_stage(stage), m_start(std::chrono::steady_clock::now())
+    {
+    }
+
+    ~stage_timer_t()
+    {
+        record_stage(m_stage, std::chrono::steady_clock::now() - m_start);
+    }
+
+    stage_timer_t(const stage_timer_t&) = delete;
+    stage_timer_t& operator=(const stage_timer_t&) = delete;
+
+private:
+    const stage_t m_stage;
+    const std::chrono::steady_clock::time_point m_start;
+};
+
+// The current values as a JSON object, and as an aligned text table.
+std::string get_json_snapshot();
+std::string get_text_snapshot();
+
+// Publishes a snapshot every interval and, if dump_path is not empty,
+// rewrites that file with the text form. Both are also written on stop.
+void start_exporter(std::chrono::milliseconds interval, const std::string& dump_path);
+void stop_exporter();
+
+} // namespace metrics
@@ -0,0 +1,56 @@
+/////////////////////////////////////////////
+// Copyright (c) Gaia Platform LLC
+// All rights reserved.
+/////////////////////////////////////////////
+
+#pragma once
+
+#include <future>
+#include <memory>
+#include <string>
+
+#include <aws/crt/Api.h>
+#include <aws/iot/MqttClient.h>
+
+#include "transport.hpp"
+
+namespace gaia
+{
+namespace access_control
+{
+namespace communication
+{
+
+// AWS IoT over websockets, authenticated with the static credentials in
+// AWS_ACCESS_KEY_ID, AWS_SECRET_ACCESS_KEY and AWS_SESSION_TOKEN.
+// Published topics are prefixed with the remote client ID.
+class mqtt_transport_t : public transport_t
+{
+public:
+    mqtt_transport_t(std::string endpoint, std::string region, std::string remote_client_id);
+
+    bool connect(const std::string& client_id, message_callback_t callback) override;
+    void run() override;
+    void publish(const std::string& topic, const std::string& payload) override;
+    void disconnect() override;
+
+private:
+    const std::string m_endpoint;
+    const std::string m_region;
+    const std::string m_remote_client_id;
+
+    // Declared before the other AWS objects so that it outlives them.
+    std::unique_ptr<Aws::Crt::ApiHandle> m_api_handle;
+    std::unique_ptr<Aws::Crt::Io::EventLoopGroup> m_event_loop_group;
+    std::unique_ptr<Aws::Crt::Io::DefaultHostResolver> m_host_resolver;
+    std::unique_ptr<Aws::Crt::Io::ClientBootstrap> m_bootstrap;
+    std::unique_ptr<Aws::Iot::MqttClient> m_mqtt_client;
+    std::shared_ptr<Aws::Crt::Mqtt::MqttConnection> m_connection;
+
+    bool m_is_subscribed = false;
+    std::promise<void> m_connection_closed_promise;
+};
+
+} // namespace communication
+} // namespace access_control
+} // namespace gaia
@@ -0,0 +1,47 @@
+/////////////////////////////////////////////
+// Copyright (c) Gaia Platform LLC
+// All rights reserved.
+/////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+
+#include "gaia_access_control.h"
+
+// The number of people inside each room and building, kept in memory next
+// to the people_inside and people_entered relationships. A counter column
+// in the room and building rows would be written by every person entering
+// or leaving, which makes busy rooms a write-conflict hotspot for the scan
+// workers and fires on_update(room) for every move.
+//
+// Each person is counted in at most one room and one building, and moving
+// a person to where they are already counted changes nothing, so a rule
+// retried after a conflict counts its person once. A rule that fails for
+// good after counting someone leaves them counted until they next move.
+namespace occupancy
+{
+
+// Counts the person into the room, and out of the room they were counted
+// in before, unless the room already holds capacity people. A capacity of
+// 0 means no limit. Returns false, and changes nothing, if the room is
+// full; a person already counted in the room always fits.
+bool enter_room(gaia::common::gaia_id_t person_id, gaia::common::gaia_id_t room_id, uint32_t capacity);
+
+// Counts the person out of the room, if they are counted in it.
+void leave_room(gaia::common::gaia_id_t person_id, gaia::common::gaia_id_t room_id);
+
+// Counts the person into the building, and out of the one they were
+// counted in before.
+void enter_building(gaia::common::gaia_id_t person_id, gaia::common::gaia_id_t building_id);
+
+// Counts the person out of the building, if they are counted in it.
+void leave_building(gaia::common::gaia_id_t person_id, gaia::common::gaia_id_t building_id);
+
+uint32_t get_room_occupancy(gaia::common::gaia_id_t room_id);
+uint32_t get_building_occupancy(gaia::common::gaia_id_t building_id);
+
+// Call whenever the tables are wiped.
+void clear();
+
+} // namespace occupancy
@@ -0,0 +1,78 @@
+/////////////////////////////////////////////
+// Copyright (c) Gaia Platform LLC
+// All rights reserved.
+/////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Outbound pipeline between the rules and the MQTT connection.
+//
+// Messages are collected for a short window, starting with the first
+// message after the previous flush, and then sent in order from a
+// dedicated thread. Within a window, state messages only keep their latest
+// value: a person's "move_to_room" and "move_to_building" messages both
+// describe where that person is, so only the last one is sent. A single
+// face scan that moves someone out of one room and into another then costs
+// one publish instead of two.
+class publish_coalescer_t
+{
+public:
+    typedef std::function<void(const std::string& topic, const std::string& payload)> sink_t;
+
+    publish_coalescer_t(std::chrono::microseconds window, sink_t sink);
+    ~publish_coalescer_t();
+
+    void start();
+
+    // Sends whatever is pending and joins the worker thread. Messages
+    // published from then on are sent immediately.
+    void stop();
+
+    void publish(const std::string& topic, const std::string& payload);
+
+    uint64_t get_coalesced_count() const
+    {
+        return m_coalesced_count;
+    }
+
+private:
+    // Returns true if the topic carries state, along with the key that
+    // identifies which state it describes.
+    static bool get_state_key(const std::string& topic, std::string& key);
+
+    void worker();
+
+private:
+    struct pending_message_t
+    {
+        std::string topic;
+        std::string payload;
+        bool is_superseded;
+    };
+
+    const std::chrono::microseconds m_window;
+    const sink_t m_sink;
+
+    std::mutex m_lock;
+    std::condition_variable m_work_available;
+    std::vector<pending_message_t> m_pending;
+    // Position in m_pending of the latest message for each state key.
+    std::unordered_map<std::string, size_t> m_state_positions;
+    std::chrono::steady_clock::time_point m_window_start;
+    bool m_stopping = false;
+    // Set by the worker once it has sent its last batch.
+    bool m_is_stopped = false;
+
+    std::atomic<uint64_t> m_coalesced_count{0};
+    std::thread m_worker;
+};
@@ -0,0 +1,105 @@
+/////////////////////////////////////////////
+// Copyright (c) Gaia Platform LLC
+// All rights reserved.
+/////////////////////////////////////////////
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include "gaia_access_control.h"
+
+// Per-rule profiling of access_control_ruleset.
+//
+// Every rule opens a scope_t naming the rule and the row that triggered
+// it. The scope always feeds the "rules" stage of metrics; when profiling
+// is enabled it also counts invocations, wall time and cascade depth per
+// rule.
+//
+// The cascade depth of a rule is 1 if the row that triggered it was last
+// written by the application, and one more than the depth of the rule that
+// last wrote that row otherwise. A badge scan, for example, shows up as
+// on_insert(scan) at depth 1, which sets scan.badge_scan; the @badge_scan
+// rule at depth 2, which sets person.badged; and the rule reacting to
+// @badged at depth 3. Rules declare the rows they write with
+// scope_t::wrote(), and helpers that write rows on a rule's behalf with
+// rule_profiler::wrote().
+namespace rule_profiler
+{
+
+// One entry per rule of access_control_ruleset, in order.
+enum class rule_t : size_t
+{
+    scan_inserted,
+    scan_updated,
+    person_updated,
+    room_updated,
+    event_updated,
+    badge_scan,
+    joining_wifi,
+    leaving_wifi,
+    vehicle_entering,
+    vehicle_departing,
+    face_without_credentials,
+    credentials_changed,
+    employee_face_scan,
+    visitor_face_scan,
+    inadmissible_face_scan,
+    leaving,
+    count
+};
+
+// Deeper cascades are counted as this depth.
+constexpr uint32_t c_max_tracked_depth = 15;
+
+void enable();
+bool is_enabled();
+
+class scope_t
+{
+public:
+    scope_t(rule_t rule, gaia::common::gaia_id_t trigger_id);
+    ~scope_t();
+
+    // Records that this rule changed the given row, so that rules it
+    // triggers are attributed one level deeper.
+    void wrote(gaia::common::gaia_id_t row_id);
+
+    rule_t get_rule() const
+    {
+        return m_rule;
+    }
+
+    // Unique within a run; a rule retried after a conflict gets a new one.
+    uint64_t get_invocation_id() const
+    {
+        return m_invocation_id;
+    }
+
+    scope_t(const scope_t&) = delete;
+    scope_t& operator=(const scope_t&) = delete;
+
+private:
+    scope_t* const m_outer;
+    const rule_t m_rule;
+    const uint64_t m_invocation_id;
+    const std::chrono::steady_clock::time_point m_start;
+    uint32_t m_depth = 0;
+};
+
+// Records that the innermost scope open on this thread changed the given
+// row. Does nothing outside a rule.
+void wrote(gaia::common::gaia_id_t row_id);
+
+// The innermost scope open on this thread, or nullptr outside a rule.
+const scope_t* get_current_scope();
+
+// A table of all rules that fired, most expensive first.
+std::string get_report();
+
+// Writes the report to path, or to stdout if path is "-".
+void write_report(const std::string& path);
+
+} // namespace rule_profiler
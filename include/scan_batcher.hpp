@@ -0,0 +1,66 @@
+/////////////////////////////////////////////
+// Copyright (c) Gaia Platform LLC
+// All rights reserved.
+/////////////////////////////////////////////
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "scan_message.hpp"
+
+// Accumulates incoming scans and hands them to a flush callback in batches,
+// so that many scans can be inserted in a single transaction.
+//
+// A batch is flushed as soon as it holds max_batch_size scans, or when its
+// oldest scan has waited max_latency, whichever comes first. Flushes run on
+// a dedicated worker thread that owns its own database session. The flush
+// callback returns false if it had to drop the batch.
+class scan_batcher_t
+{
+public:
+    typedef std::function<bool(const std::vector<scan_message_t>&)> flush_callback_t;
+
+    scan_batcher_t(
+        size_t max_batch_size,
+        std::chrono::microseconds max_latency,
+        flush_callback_t flush_callback);
+    ~scan_batcher_t();
+
+    void start();
+
+    // Flushes whatever is pending and joins the worker thread.
+    void stop();
+
+    void submit(const scan_message_t& scan);
+
+    // Blocks until every scan submitted so far has been flushed or dropped.
+    void flush();
+
+private:
+    void worker();
+
+private:
+    const size_t m_max_batch_size;
+    const std::chrono::microseconds m_max_latency;
+    const flush_callback_t m_flush_callback;
+
+    std::mutex m_lock;
+    std::condition_variable m_work_available;
+    std::condition_variable m_batch_flushed;
+
+    std::vector<scan_message_t> m_pending;
+    std::chrono::steady_clock::time_point m_oldest_pending;
+    uint64_t m_submitted_count = 0;
+    uint64_t m_flushed_count = 0;
+    uint64_t m_dropped_count = 0;
+    bool m_flush_requested = false;
+    bool m_stopping = false;
+
+    std::thread m_worker;
+};
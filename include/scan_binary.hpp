@@ -0,0 +1,58 @@
+/////////////////////////////////////////////
+// Copyright (c) Gaia Platform LLC
+// All rights reserved.
+/////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "scan_message.hpp"
+
+// Fixed-layout binary scan frames, for turnstile controllers that cannot
+// produce JSON.
+//
+// A record is 128 bytes, all integers little-endian:
+//
+//     offset  size  field
+//          0     1  version (c_record_version)
+//          1     1  scan_type (e_scan_type)
+//          2     1  flags: bit 0 = room_id present, bit 1 = building_id present
+//          3     1  face_signature length (at most 64)
+//          4     1  license length (at most 24)
+//          5     3  reserved, must be zero
+//          8     8  person_id
+//         16     8  room_id
+//         24     8  building_id
+//         32     8  timestamp
+//         40    64  face_signature bytes, zero padded
+//        104    24  license bytes, zero padded
+//
+// "access_control/scan_bin" carries exactly one record.
+// "access_control/scan_bin_batch" carries an 8-byte header (version byte,
+// 3 reserved bytes, uint32 record count) followed by that many records.
+// Records and headers whose reserved bytes are not zero are rejected, so
+// that later versions can give them a meaning.
+namespace scan_binary
+{
+
+constexpr uint8_t c_record_version = 1;
+constexpr size_t c_record_size = 128;
+constexpr size_t c_batch_header_size = 8;
+
+constexpr uint8_t c_has_room_id_flag = 0x1;
+constexpr uint8_t c_has_building_id_flag = 0x2;
+
+// Returns false if the record is malformed, including non-zero reserved
+// bytes.
+bool decode_record(std::string_view record, scan_message_t& scan);
+
+void encode_record(const scan_message_t& scan, uint8_t* record);
+
+// Decodes every record of a batch frame into scans. Returns false, with
+// scans unspecified, if the header or any record is invalid.
+bool decode_batch(std::string_view frame, std::vector<scan_message_t>& scans);
+
+} // namespace scan_binary
@@ -0,0 +1,46 @@
+/////////////////////////////////////////////
+// Copyright (c) Gaia Platform LLC
+// All rights reserved.
+/////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+#include "enums.hpp"
+
+constexpr size_t c_max_face_signature_length = 64;
+constexpr size_t c_max_license_length = 24;
+
+// A decoded scan, ready to be inserted into the scan table.
+//
+// The optional face signature and license are stored inline so that a scan
+// can be decoded and queued without allocating.
+struct scan_message_t
+{
+    enums::scan_table::e_scan_type scan_type;
+    uint64_t person_id;
+    uint64_t room_id;
+    uint64_t building_id;
+    bool has_room_id;
+    bool has_building_id;
+
+    // Zero when the sender did not provide one.
+    uint64_t timestamp;
+
+    uint8_t face_signature_length;
+    uint8_t license_length;
+    char face_signature[c_max_face_signature_length];
+    char license[c_max_license_length];
+
+    std::string_view get_face_signature() const
+    {
+        return std::string_view(face_signature, face_signature_length);
+    }
+
+    std::string_view get_license() const
+    {
+        return std::string_view(license, license_length);
+    }
+};
@@ -0,0 +1,31 @@
+/////////////////////////////////////////////
+// Copyright (c) Gaia Platform LLC
+// All rights reserved.
+/////////////////////////////////////////////
+
+#pragma once
+
+#include <string_view>
+
+#include "enums.hpp"
+#include "scan_message.hpp"
+
+// Allocation-free decoding of "access_control/scan" payloads.
+namespace scan_parser
+{
+
+// Maps a scan type name ("badge", "face", ...) to its enum value.
+bool scan_type_from_string(std::string_view name, enums::scan_table::e_scan_type& scan_type);
+
+// Decodes a flat JSON object such as
+//     {"scan_type":"face","person_id":1,"room_id":102,"building_id":10}
+// straight into a scan_message_t, without building a DOM. Unknown keys are
+// skipped. room_id and building_id may be null or absent.
+//
+// Returns false if the payload is not in that form (malformed JSON, a
+// missing person_id, IDs that are not plain unsigned integers, escaped keys
+// or an unknown or escaped scan_type, ...); the caller may then fall back to
+// a general-purpose JSON parser.
+bool parse(std::string_view payload, scan_message_t& scan);
+
+} // namespace scan_parser
@@ -0,0 +1,74 @@
+/////////////////////////////////////////////
+// Copyright (c) Gaia Platform LLC
+// All rights reserved.
+/////////////////////////////////////////////
+
+#pragma once
+
+#include <chrono>
+#include <vector>
+
+#include "gaia_access_control.h"
+
+#include "enums.hpp"
+#include "rule_profiler.hpp"
+
+// Ages out processed scans so that the scan table and the person, room,
+// building and vehicle scan lists stay bounded.
+//
+// A scan is queued once it is committed and every rule that reacts to it is
+// done with it: on_insert(scan) names the rules that will follow, and each
+// of them reports when it returns. A background thread deletes the scans
+// handled longer ago than the retention period in batches, disconnecting
+// each from its four relationships first. With rollups on, every deleted
+// scan is first counted in the scan_rollup row of its building and of the
+// application-clock hour at which it arrived. A scan whose rules have not
+// all reported several retention periods after it was committed, because
+// one failed for good, is queued anyway, with a warning.
+namespace scan_retention
+{
+
+// Reports scans that were just committed. Does nothing unless started.
+void add_scans(const std::vector<gaia::common::gaia_id_t>& scan_ids);
+
+// Called by on_insert(scan): expect_rules() once it has set the flag of the
+// scan's type, expect_no_rules() if it set none, so that no other rule
+// reacts to the scan.
+void expect_rules(gaia::common::gaia_id_t scan_id, enums::scan_table::e_scan_type scan_type);
+void expect_no_rules(gaia::common::gaia_id_t scan_id);
+
+// Reports that a rule is done with a scan. Reporting again, from a rule
+// retried after a conflict, has no further effect.
+void mark_handled(gaia::common::gaia_id_t scan_id, rule_profiler::rule_t rule);
+
+// Calls mark_handled() when the rule returns, whichever way it does.
+class handled_scope_t
+{
+public:
+    handled_scope_t(rule_profiler::rule_t rule, gaia::common::gaia_id_t scan_id)
+        : m_rule(rule), m_scan_id(scan_id)
+    {
+    }
+
+    ~handled_scope_t()
+    {
+        mark_handled(m_scan_id, m_rule);
+    }
+
+    handled_scope_t(const handled_scope_t&) = delete;
+    handled_scope_t& operator=(const handled_scope_t&) = delete;
+
+private:
+    const rule_profiler::rule_t m_rule;
+    const gaia::common::gaia_id_t m_scan_id;
+};
+
+// Also queues the scans already in the table, such as those kept across a
+// restart. Must be called outside a transaction.
+void start(std::chrono::milliseconds retention, bool is_rollup_enabled);
+void stop();
+
+// Call whenever the tables are wiped.
+void clear();
+
+} // namespace scan_retention
@@ -0,0 +1,44 @@
+/////////////////////////////////////////////
+// Copyright (c) Gaia Platform LLC
+// All rights reserved.
+/////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Bulk loading of a site's buildings, rooms, people, events, registrations
+// and room permissions from a newline-delimited JSON file.
+//
+// Each line holds one row, named by its "table" field:
+//
+//     {"table": "building", "building_id": 10, "name": "HQ Building"}
+//     {"table": "room", "room_id": 102, "name": "Auditorium", "capacity": 200, "building_id": 10}
+//     {"table": "person", "person_id": 1, "first_name": "John", "employee": true}
+//     {"table": "event", "event_id": "e1", "name": "Happy hour",
+//      "start_timestamp": 720, "end_timestamp": 840, "room_id": 102}
+//     {"table": "registration", "person_id": 1, "event_id": "e1"}
+//     {"table": "permission", "person_id": 1, "room_id": 102}
+//
+// A person may also carry last_name, badge_number, face_signature,
+// visitor, stranger, credentialed, admissible, entry_time and leave_time.
+// Rows refer to each other by external ID, so a row must come after the
+// rows it refers to. Malformed rows, rows referring to unknown IDs and rows
+// repeating an ID already imported are logged and skipped.
+namespace site_import
+{
+
+struct import_stats_t
+{
+    uint64_t row_count;
+    uint64_t skipped_row_count;
+    uint64_t transaction_count;
+};
+
+// Inserts the rows of the file at path, committing every batch_size rows.
+// Must be called outside a transaction, before the workers start. Returns
+// false if the file cannot be read.
+bool import_file(const std::string& path, uint64_t batch_size, import_stats_t& stats);
+
+} // namespace site_import
@@ -0,0 +1,72 @@
+/////////////////////////////////////////////
+// Copyright (c) Gaia Platform LLC
+// All rights reserved.
+/////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <queue>
+#include <utility>
+#include <vector>
+
+// Items due at points on the application clock, i.e. the time set through
+// helpers::set_time(), kept in a binary min-heap.
+//
+// Not thread-safe; owners guard it with their own lock. Items cannot be
+// cancelled: owners tag them (e.g. with a generation number) and ignore
+// the ones that have gone stale when they come due.
+template <typename T>
+class time_scheduler_t
+{
+public:
+    void schedule(uint64_t time, T item)
+    {
+        m_heap.push({time, m_next_sequence++, std::move(item)});
+    }
+
+    // Pops every item due at or before now, in time order and, for equal
+    // times, in the order they were scheduled, and passes it to
+    // on_due(time, item). on_due may schedule further items; those that are
+    // already due are run in the same call.
+    template <typename F>
+    void run_until(uint64_t now, F on_due)
+    {
+        while (!m_heap.empty() && m_heap.top().time <= now)
+        {
+            entry_t entry = m_heap.top();
+            m_heap.pop();
+            on_due(entry.time, entry.item);
+        }
+    }
+
+    void clear()
+    {
+        m_heap = {};
+    }
+
+    size_t size() const
+    {
+        return m_heap.size();
+    }
+
+private:
+    struct entry_t
+    {
+        uint64_t time;
+        uint64_t sequence;
+        T item;
+    };
+
+    struct is_later_t
+    {
+        bool operator()(const entry_t& left, const entry_t& right) const
+        {
+            return left.time != right.time ? left.time > right.time : left.sequence > right.sequence;
+        }
+    };
+
+private:
+    std::priority_queue<entry_t, std::vector<entry_t>, is_later_t> m_heap;
+    uint64_t m_next_sequence = 0;
+};
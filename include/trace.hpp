@@ -0,0 +1,67 @@
+/////////////////////////////////////////////
+// Copyright (c) Gaia Platform LLC
+// All rights reserved.
+/////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "transport.hpp"
+
+// Recording and replay of incoming traffic.
+//
+// A trace is an append-only file holding every received message, including
+// the "access_control/time" updates, with its arrival time. It starts with
+// the 8-byte magic "ACTRACE1" and then holds one record per message, with
+// integers in little-endian order:
+//
+//     uint64_t arrival_ns       nanoseconds since recording started
+//     uint16_t topic_length
+//     uint32_t payload_length
+//     char topic[topic_length]
+//     char payload[payload_length]
+//
+// A record cut short, e.g. by a crash while recording, ends the trace.
+// Records are buffered and flushed to the file at least once a second.
+namespace trace
+{
+
+enum class replay_mode_t
+{
+    // Deliver each message as soon as the previous one was accepted.
+    asap,
+    // Keep the recorded spacing between messages.
+    realtime,
+};
+
+bool parse_replay_mode(const std::string& name, replay_mode_t& mode);
+
+// Starts appending received messages to the file at path, which is created
+// if needed. Recording into an existing trace first drops its partial last
+// record, if any, and continues its arrival times. Returns false if the
+// file cannot be opened or is not a trace.
+bool start_recording(const std::string& path);
+
+// Appends one message. Does nothing unless recording.
+void record(const std::string& topic, const std::string& payload);
+
+void stop_recording();
+
+struct replay_stats_t
+{
+    uint64_t message_count;
+    uint64_t payload_bytes;
+    // Recorded duration of the trace.
+    uint64_t trace_duration_ns;
+    bool is_truncated;
+};
+
+// Delivers every message of the trace at path to callback, in order, from
+// the calling thread. Returns false if the file is not a trace.
+bool replay(
+    const std::string& path, replay_mode_t mode,
+    gaia::access_control::communication::message_callback_t callback, replay_stats_t& stats);
+
+} // namespace trace
@@ -0,0 +1,47 @@
+/////////////////////////////////////////////
+// Copyright (c) Gaia Platform LLC
+// All rights reserved.
+/////////////////////////////////////////////
+
+#pragma once
+
+#include <string>
+
+namespace gaia
+{
+namespace access_control
+{
+namespace communication
+{
+
+typedef void (*message_callback_t)(const std::string& topic, const std::string& payload);
+typedef void (*publish_sink_t)(const std::string& topic, const std::string& payload);
+
+// The message connection behind communication::connect() and
+// communication::publish_message().
+//
+// Incoming topics are delivered with the client ID as their first level
+// ("<client_id>/access_control/scan"); published topics are relative
+// ("access_control/alert") and the transport addresses them.
+class transport_t
+{
+public:
+    virtual ~transport_t() = default;
+
+    // Connects and subscribes to everything sent to client_id. Messages are
+    // passed to callback from the transport's own thread. Returns false if
+    // the connection could not be established.
+    virtual bool connect(const std::string& client_id, message_callback_t callback) = 0;
+
+    // Blocks for as long as the session should last.
+    virtual void run() = 0;
+
+    // May be called from any thread once connected.
+    virtual void publish(const std::string& topic, const std::string& payload) = 0;
+
+    virtual void disconnect() = 0;
+};
+
+} // namespace communication
+} // namespace access_control
+} // namespace gaia
@@ -0,0 +1,63 @@
+/////////////////////////////////////////////
+// Copyright (c) Gaia Platform LLC
+// All rights reserved.
+/////////////////////////////////////////////
+
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <string>
+
+#include "gaia_access_control.h"
+
+// Builds the JSON messages that drive the web GUI.
+//
+// Besides full snapshots, the GUI can be kept up to date with deltas: the
+// rules and helpers that change a person, room or building mark it here,
+// and a background publisher periodically sends only the marked entities
+// on "access_control_delta". Every message (full or delta) carries a
+// "seq" number; a subscriber that joins late or sees a gap in the sequence
+// asks for a full snapshot by publishing on "access_control/ui_sync".
+// Deltas are best-effort: a change whose transaction commits later than
+// expected may be sent with its old state, so the publisher also sends a
+// full snapshot at a fixed interval.
+namespace ui
+{
+
+// Payload for "access_control/init". Must be called inside a transaction.
+std::string get_init_message();
+
+// The latest payload for "access_control/init", kept pre-serialized so
+// that it can be served without reading the database. While the delta
+// publisher runs, it rebuilds the payload in the background once changed
+// rows have settled; otherwise, or if there is none yet, it is built here
+// in a transaction of its own. Must be called outside a transaction.
+std::shared_ptr<const std::string> get_cached_init_message();
+
+// Publishes a full "access_control_json" snapshot in its own transaction.
+void update_ui();
+
+// Person and event fragments are cached between messages. Marking a person
+// changed also drops its cached fragment.
+void mark_person_changed(gaia::common::gaia_id_t person_id);
+void mark_room_changed(gaia::common::gaia_id_t room_id);
+void mark_building_changed(gaia::common::gaia_id_t building_id);
+
+// Called when a room or event row is updated. Their names are embedded in
+// other fragments, so every cached fragment is dropped.
+void invalidate_room(gaia::common::gaia_id_t room_id);
+void invalidate_event(gaia::common::gaia_id_t event_id);
+
+// Forgets every pending change and cached fragment, e.g. after the tables
+// have been wiped.
+void clear_changes();
+
+// Asks the delta publisher to send a full snapshot on its next tick.
+void request_full_snapshot();
+
+// A snapshot_interval of 0 sends full snapshots only when requested.
+void start_delta_publisher(std::chrono::milliseconds interval, std::chrono::milliseconds snapshot_interval);
+void stop_delta_publisher();
+
+} // namespace ui
@@ -1,6 +1,7 @@
 #include "actions.hpp"
 
 #include "communication.hpp"
+#include "metrics.hpp"
 
 #include "gaia/logger.hpp"
 
@@ -11,18 +12,21 @@ const std::string c_alert_topic = "access_control/alert";
 void actions::stranger_detected()
 {
     gaia_log::app().info("Stranger detected!");
+    metrics::count(metrics::counter_t::strangers_detected);
     communication::publish_message(c_alert_topic, "Stranger detected");
 }
 
 void actions::no_eligible_events(uint64_t person_id)
 {
     gaia_log::app().info("No eligible events for visitor #{}.", person_id);
+    metrics::count(metrics::counter_t::alerts_no_eligible_events);
     communication::publish_message(c_alert_topic, "No eligible events for visitor");
 }
 
 void actions::base_credentials_required(uint64_t person_id)
 {
     gaia_log::app().info("Base credentials required for person #{} to enter.", person_id);
+    metrics::count(metrics::counter_t::alerts_base_credentials_required);
     communication::publish_message(c_alert_topic, "Base credentials required to enter");
 }
 
@@ -31,6 +35,7 @@ void actions::no_entry_right_now(
 {
     gaia_log::app().info("No entry right now for person #{} into room {}, building {}.",
         person_id, room_name, building_name);
+    metrics::count(metrics::counter_t::alerts_no_entry_right_now);
     communication::publish_message(c_alert_topic, "Entry not currently allowed");
 }
 
@@ -38,6 +43,7 @@ void actions::not_this_building(uint64_t person_id, std::string building_name)
 {
     gaia_log::app().info("Person #{} is not allowed into building {}.",
         person_id, building_name);
+    metrics::count(metrics::counter_t::alerts_not_this_building);
     communication::publish_message(c_alert_topic, "Entry into building not allowed");
 }
 
@@ -46,5 +52,22 @@ void actions::not_this_room(
 {
     gaia_log::app().info("Person #{} is not allowed into room {}, building {}.",
         person_id, room_name, building_name);
+    metrics::count(metrics::counter_t::alerts_not_this_room);
     communication::publish_message(c_alert_topic, "Entry into room not allowed");
+}
+
+void actions::room_at_capacity(
+    uint64_t person_id, std::string room_name, std::string building_name)
+{
+    gaia_log::app().info("Person #{} cannot enter room {}, building {}: the room is at capacity.",
+        person_id, room_name, building_name);
+    metrics::count(metrics::counter_t::alerts_room_at_capacity);
+    communication::publish_message(c_alert_topic, "Room at capacity");
+}
+
+void actions::ingest_overloaded(uint64_t rejected_count)
+{
+    gaia_log::app().warn("Ingest queue full: {} messages rejected so far.", rejected_count);
+    metrics::count(metrics::counter_t::alerts_ingest_overloaded);
+    communication::publish_message(c_alert_topic, "Scans rejected: system overloaded");
 }
\ No newline at end of file
@@ -0,0 +1,255 @@
+/////////////////////////////////////////////
+// Copyright (c) Gaia Platform LLC
+// All rights reserved.
+/////////////////////////////////////////////
+
+#include "active_events.hpp"
+
+#include <limits>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "time_scheduler.hpp"
+
+namespace active_events
+{
+
+using gaia::common::c_invalid_gaia_id;
+using gaia::common::gaia_id_t;
+
+struct event_state_t
+{
+    gaia_id_t room_id;
+    uint64_t start_timestamp;
+    uint64_t end_timestamp;
+    // Bumped whenever the event is rescheduled, to retire its old boundaries.
+    uint64_t generation;
+    bool is_active;
+    std::vector<gaia_id_t> registrants;
+};
+
+struct boundary_t
+{
+    gaia_id_t event_id;
+    uint64_t generation;
+    bool is_start;
+};
+
+struct person_room_t
+{
+    gaia_id_t person_id;
+    gaia_id_t room_id;
+
+    bool operator==(const person_room_t& other) const
+    {
+        return person_id == other.person_id && room_id == other.room_id;
+    }
+};
+
+struct person_room_hash_t
+{
+    size_t operator()(const person_room_t& key) const
+    {
+        return std::hash<gaia_id_t>()(key.person_id * 0x9E3779B97F4A7C15ull ^ key.room_id);
+    }
+};
+
+std::shared_mutex g_lock;
+uint64_t g_now = 0;
+time_scheduler_t<boundary_t> g_scheduler;
+std::unordered_map<gaia_id_t, event_state_t> g_events;
+std::unordered_set<gaia_id_t> g_tracked_persons;
+
+// Number of active events per person, and per person and room.
+std::unordered_map<gaia_id_t, uint32_t> g_active_by_person;
+std::unordered_map<person_room_t, uint32_t, person_room_hash_t> g_active_by_person_room;
+
+void add_active(gaia_id_t person_id, gaia_id_t room_id, int32_t delta)
+{
+    if ((g_active_by_person[person_id] += delta) == 0)
+    {
+        g_active_by_person.erase(person_id);
+    }
+
+    if (room_id != c_invalid_gaia_id)
+    {
+        person_room_t key{person_id, room_id};
+        if ((g_active_by_person_room[key] += delta) == 0)
+        {
+            g_active_by_person_room.erase(key);
+        }
+    }
+}
+
+void set_active(event_state_t& event, bool is_active)
+{
+    if (event.is_active == is_active)
+    {
+        return;
+    }
+
+    event.is_active = is_active;
+    for (gaia_id_t person_id : event.registrants)
+    {
+        add_active(person_id, event.room_id, is_active ? 1 : -1);
+    }
+}
+
+void schedule_end(gaia_id_t event_id, const event_state_t& event)
+{
+    if (event.end_timestamp < std::numeric_limits<uint64_t>::max())
+    {
+        g_scheduler.schedule(event.end_timestamp + 1, {event_id, event.generation, false});
+    }
+}
+
+// Activates the event if it is under way at g_now, and schedules its next
+// boundary.
+void schedule_event(gaia_id_t event_id, event_state_t& event)
+{
+    if (event.end_timestamp < event.start_timestamp || event.end_timestamp < g_now)
+    {
+        return;
+    }
+
+    if (event.start_timestamp > g_now)
+    {
+        g_scheduler.schedule(event.start_timestamp, {event_id, event.generation, true});
+    }
+    else
+    {
+        set_active(event, true);
+        schedule_end(event_id, event);
+    }
+}
+
+void on_boundary(uint64_t, const boundary_t& boundary)
+{
+    auto event = g_events.find(boundary.event_id);
+    if (event == g_events.end() || event->second.generation != boundary.generation)
+    {
+        return;
+    }
+
+    if (boundary.is_start)
+    {
+        set_active(event->second, true);
+        schedule_end(boundary.event_id, event->second);
+    }
+    else
+    {
+        set_active(event->second, false);
+    }
+}
+
+void add_person(gaia_id_t person_id)
+{
+    std::unique_lock lock(g_lock);
+    g_tracked_persons.insert(person_id);
+}
+
+void add_event(gaia_id_t event_id, gaia_id_t room_id, uint64_t start_timestamp, uint64_t end_timestamp)
+{
+    std::unique_lock lock(g_lock);
+    event_state_t& event = g_events[event_id];
+    event = {room_id, start_timestamp, end_timestamp, 0, false, {}};
+    schedule_event(event_id, event);
+}
+
+void add_registration(gaia_id_t person_id, gaia_id_t event_id)
+{
+    std::unique_lock lock(g_lock);
+
+    auto event = g_events.find(event_id);
+    if (event == g_events.end() || g_tracked_persons.count(person_id) == 0)
+    {
+        return;
+    }
+
+    event->second.registrants.push_back(person_id);
+    if (event->second.is_active)
+    {
+        add_active(person_id, event->second.room_id, 1);
+    }
+}
+
+void update_event(gaia_id_t event_id, gaia_id_t room_id, uint64_t start_timestamp, uint64_t end_timestamp)
+{
+    std::unique_lock lock(g_lock);
+
+    auto event = g_events.find(event_id);
+    if (event == g_events.end())
+    {
+        return;
+    }
+
+    event_state_t& state = event->second;
+    if (state.room_id == room_id && state.start_timestamp == start_timestamp && state.end_timestamp == end_timestamp)
+    {
+        return;
+    }
+
+    set_active(state, false);
+    state.room_id = room_id;
+    state.start_timestamp = start_timestamp;
+    state.end_timestamp = end_timestamp;
+    state.generation++;
+    schedule_event(event_id, state);
+}
+
+void set_time(uint64_t time)
+{
+    std::unique_lock lock(g_lock);
+
+    if (time >= g_now)
+    {
+        g_now = time;
+        g_scheduler.run_until(time, on_boundary);
+        return;
+    }
+
+    // The clock went back: start over from the events' windows.
+    g_now = time;
+    g_scheduler.clear();
+    for (auto& [event_id, event] : g_events)
+    {
+        set_active(event, false);
+        event.generation++;
+        schedule_event(event_id, event);
+    }
+}
+
+bool find_active_event(gaia_id_t person_id, gaia_id_t room_id, bool& has_event)
+{
+    std::shared_lock lock(g_lock);
+
+    if (g_tracked_persons.count(person_id) == 0)
+    {
+        return false;
+    }
+
+    if (room_id == c_invalid_gaia_id)
+    {
+        has_event = g_active_by_person.count(person_id) > 0;
+    }
+    else
+    {
+        has_event = g_active_by_person_room.count({person_id, room_id}) > 0;
+    }
+    return true;
+}
+
+void clear()
+{
+    std::unique_lock lock(g_lock);
+    g_scheduler.clear();
+    g_events.clear();
+    g_tracked_persons.clear();
+    g_active_by_person.clear();
+    g_active_by_person_room.clear();
+}
+
+} // namespace active_events
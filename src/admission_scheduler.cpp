@@ -0,0 +1,227 @@
+/////////////////////////////////////////////
+// Copyright (c) Gaia Platform LLC
+// All rights reserved.
+/////////////////////////////////////////////
+
+#include "admission_scheduler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "gaia/db/db.hpp"
+#include "gaia/logger.hpp"
+
+#include "helpers.hpp"
+#include "time_scheduler.hpp"
+
+using namespace gaia::access_control;
+using gaia::common::gaia_id_t;
+
+namespace admission_scheduler
+{
+
+// Rules update the same people, so conflicting re-evaluations are retried
+// with a growing back-off.
+constexpr uint32_t c_max_update_attempts = 8;
+constexpr std::chrono::microseconds c_update_retry_backoff{100};
+
+struct window_t
+{
+    uint64_t entry_time;
+    uint64_t leave_time;
+    // Bumped whenever the person is rescheduled, to retire old boundaries.
+    uint64_t generation;
+};
+
+struct boundary_t
+{
+    gaia_id_t person_id;
+    uint64_t generation;
+};
+
+std::mutex g_lock;
+uint64_t g_now = 0;
+time_scheduler_t<boundary_t> g_scheduler;
+std::unordered_map<gaia_id_t, window_t> g_windows;
+
+// People whose re-evaluation is not committed yet: those that came due
+// while the caller had a transaction open, and those of a failed update.
+std::vector<gaia_id_t> g_pending_person_ids;
+
+bool is_open(const window_t& window, uint64_t time)
+{
+    return helpers::time_is_between(time, window.entry_time, window.leave_time);
+}
+
+// Schedules the first boundary of the window after g_now.
+void schedule_next_boundary(gaia_id_t person_id, const window_t& window)
+{
+    if (g_now < window.entry_time)
+    {
+        g_scheduler.schedule(window.entry_time, {person_id, window.generation});
+    }
+    else if (g_now <= window.leave_time && window.leave_time < std::numeric_limits<uint64_t>::max())
+    {
+        g_scheduler.schedule(window.leave_time + 1, {person_id, window.generation});
+    }
+}
+
+// Must be called inside a transaction.
+void reevaluate(const std::vector<gaia_id_t>& person_ids, uint64_t time)
+{
+    for (gaia_id_t person_id : person_ids)
+    {
+        person_t person = person_t::get(person_id);
+        if (!person || !person.credentialed())
+        {
+            continue;
+        }
+
+        bool is_admissible = helpers::time_is_between(time, person.entry_time(), person.leave_time());
+        if (person.admissible() != is_admissible)
+        {
+            auto person_w = person.writer();
+            person_w.admissible = is_admissible;
+            person_w.update_row();
+        }
+    }
+}
+
+void add_person(gaia_id_t person_id, uint64_t entry_time, uint64_t leave_time)
+{
+    std::lock_guard lock(g_lock);
+    window_t& window = g_windows[person_id];
+    window = {entry_time, leave_time, 0};
+    schedule_next_boundary(person_id, window);
+}
+
+void update_person(gaia_id_t person_id, uint64_t entry_time, uint64_t leave_time)
+{
+    std::lock_guard lock(g_lock);
+
+    auto window = g_windows.find(person_id);
+    if (window == g_windows.end()
+        || (window->second.entry_time == entry_time && window->second.leave_time == leave_time))
+    {
+        return;
+    }
+
+    window->second.entry_time = entry_time;
+    window->second.leave_time = leave_time;
+    window->second.generation++;
+    schedule_next_boundary(person_id, window->second);
+}
+
+// Re-evaluates the people in a transaction of its own, retrying on
+// conflicts. Returns false if the update could not be committed.
+bool commit_reevaluation(const std::vector<gaia_id_t>& person_ids, uint64_t time)
+{
+    for (uint32_t attempt = 1;; attempt++)
+    {
+        try
+        {
+            gaia::db::begin_transaction();
+            reevaluate(person_ids, time);
+            gaia::db::commit_transaction();
+            return true;
+        }
+        catch (const gaia::db::transaction_update_conflict&)
+        {
+            if (attempt == c_max_update_attempts)
+            {
+                gaia_log::app().error(
+                    "Could not update admission of {} people after {} conflicting attempts.",
+                    person_ids.size(), attempt);
+                return false;
+            }
+            std::this_thread::sleep_for(c_update_retry_backoff * attempt);
+        }
+        catch (const std::exception& e)
+        {
+            if (gaia::db::is_transaction_open())
+            {
+                gaia::db::rollback_transaction();
+            }
+            gaia_log::app().error("Could not update admission of {} people: {}", person_ids.size(), e.what());
+            return false;
+        }
+    }
+}
+
+void set_time(uint64_t time)
+{
+    std::vector<gaia_id_t> due_person_ids;
+    {
+        std::lock_guard lock(g_lock);
+
+        if (time >= g_now)
+        {
+            g_now = time;
+            g_scheduler.run_until(time, [&due_person_ids](uint64_t, const boundary_t& boundary) {
+                auto window = g_windows.find(boundary.person_id);
+                if (window != g_windows.end() && window->second.generation == boundary.generation)
+                {
+                    due_person_ids.push_back(boundary.person_id);
+                    schedule_next_boundary(boundary.person_id, window->second);
+                }
+            });
+        }
+        else
+        {
+            // The clock went back: reschedule everyone.
+            uint64_t old_time = g_now;
+            g_now = time;
+            g_scheduler.clear();
+            for (auto& [person_id, window] : g_windows)
+            {
+                if (is_open(window, old_time) != is_open(window, time))
+                {
+                    due_person_ids.push_back(person_id);
+                }
+                window.generation++;
+                schedule_next_boundary(person_id, window);
+            }
+        }
+
+        // The caller's transaction may still abort, so the update is left
+        // to the next call made outside one.
+        if (gaia::db::is_transaction_open())
+        {
+            g_pending_person_ids.insert(g_pending_person_ids.end(), due_person_ids.begin(), due_person_ids.end());
+            return;
+        }
+
+        due_person_ids.insert(due_person_ids.end(), g_pending_person_ids.begin(), g_pending_person_ids.end());
+        g_pending_person_ids.clear();
+    }
+
+    if (due_person_ids.empty())
+    {
+        return;
+    }
+
+    // A big jump can cross both boundaries of a window.
+    std::sort(due_person_ids.begin(), due_person_ids.end());
+    due_person_ids.erase(std::unique(due_person_ids.begin(), due_person_ids.end()), due_person_ids.end());
+
+    if (!commit_reevaluation(due_person_ids, time))
+    {
+        std::lock_guard lock(g_lock);
+        g_pending_person_ids.insert(g_pending_person_ids.end(), due_person_ids.begin(), due_person_ids.end());
+    }
+}
+
+void clear()
+{
+    std::lock_guard lock(g_lock);
+    g_scheduler.clear();
+    g_windows.clear();
+    g_pending_person_ids.clear();
+}
+
+} // namespace admission_scheduler
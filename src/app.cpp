@@ -0,0 +1,858 @@
+/////////////////////////////////////////////
+// Copyright (c) Gaia Platform LLC
+// All rights reserved.
+/////////////////////////////////////////////
+
+#include "app.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "active_events.hpp"
+#include "admission_scheduler.hpp"
+#include "audit_log.hpp"
+#include "communication.hpp"
+#include "config.hpp"
+#include "enums.hpp"
+#include "helpers.hpp"
+#include "id_index.hpp"
+#include "ingest.hpp"
+#include "json.hpp"
+#include "metrics.hpp"
+#include "occupancy.hpp"
+#include "rule_profiler.hpp"
+#include "scan_batcher.hpp"
+#include "scan_binary.hpp"
+#include "scan_parser.hpp"
+#include "scan_retention.hpp"
+#include "ui.hpp"
+
+#include "gaia/db/db.hpp"
+#include "gaia/logger.hpp"
+
+using json = nlohmann::json;
+using namespace gaia::access_control;
+
+// Scan batches can still conflict with the rules, which update the same
+// people, so conflicting batches are retried until they commit, with a
+// growing back-off. A warning is logged when a batch keeps conflicting.
+const std::chrono::microseconds c_scan_batch_retry_backoff{100};
+const std::chrono::microseconds c_max_scan_batch_retry_backoff{10000};
+const uint32_t c_scan_batch_warning_attempts = 8;
+
+// Linking a scan to its room and building updates those rows, which every
+// worker shares, so concurrent batches that link scans would conflict on
+// almost every commit. Such batches are committed one at a time.
+std::mutex g_shared_link_lock;
+
+// By default up to 64 scans are committed together, and no scan waits
+// more than 1 ms for its batch to fill.
+const uint64_t c_default_scan_batch_size = 64;
+const uint64_t c_default_scan_batch_latency_us = 1000;
+
+const uint64_t c_default_ingest_queue_capacity = 4096;
+const char c_default_ingest_backpressure[] = "block";
+
+const uint64_t c_default_metrics_interval_ms = 10000;
+
+// Window for coalescing outbound messages; 0 publishes them immediately.
+// Coalescing delays every message, alerts included, by up to the window,
+// so it is only enabled on request.
+const uint64_t c_default_publish_coalesce_us = 0;
+
+// Scans are kept forever unless a retention period is given.
+const uint64_t c_default_scan_retention_ms = 0;
+
+// Interval of the UI delta publisher; 0 disables it.
+const uint64_t c_default_ui_delta_interval_ms = 100;
+
+// Deltas are best-effort, so the publisher also sends a full snapshot this
+// often; 0 only sends one when asked.
+const uint64_t c_default_ui_snapshot_interval_ms = 10000;
+
+// Each audit segment holds up to 64 MiB of records.
+const uint64_t c_default_audit_segment_records = 1 << 20;
+
+// One batcher per scan worker. Each person is always routed to the same
+// worker, which keeps their scans in order.
+std::vector<std::unique_ptr<scan_batcher_t>> g_scan_batchers;
+
+// Rows deleted per transaction by truncate_all_tables().
+const size_t c_truncate_batch_size = 10000;
+
+// Bump whenever access_control.ddl or the meaning of its columns changes,
+// so that --startup keep does not reuse data written by an older version.
+const uint32_t c_schema_version = 4;
+
+// Where stop_workers() writes the rule profile; empty unless profiling.
+std::string g_rule_profile_path;
+
+event_t add_event(std::string name, uint64_t start_timestamp,
+                    uint64_t end_timestamp, room_t room)
+{
+    auto event_w = event_writer();
+    event_w.name = name;
+    event_w.start_timestamp = start_timestamp;
+    event_w.end_timestamp = end_timestamp;
+    event_t new_event = event_t::get(event_w.insert_row());
+
+    room.events().insert(new_event);
+    active_events::add_event(new_event.gaia_id(), room.gaia_id(), start_timestamp, end_timestamp);
+
+    return new_event;
+}
+
+registration_t add_registration(person_t person, event_t occasion)
+{
+    registration_t registration = registration_t::get(registration_t::insert_row("", 0));
+
+    occasion.registrations().insert(registration);
+    person.registrations().insert(registration);
+    ui::mark_person_changed(person.gaia_id());
+
+    active_events::add_registration(person.gaia_id(), occasion.gaia_id());
+
+    return registration;
+}
+
+room_t add_room(uint64_t room_id, std::string room_name,
+              uint32_t capacity, building_t building)
+{
+    auto room_w = room_writer();
+    room_w.room_id = room_id;
+    room_w.name = room_name;
+    room_w.capacity = capacity;
+    room_t new_room = room_t::get(room_w.insert_row());
+
+    building.rooms().insert(new_room);
+    id_index::rooms().insert(room_id, new_room.gaia_id());
+
+    return new_room;
+}
+
+person_t add_person(uint64_t person_id, std::string first_name,
+                bool employee, bool visitor, bool stranger)
+{
+    auto person_w = person_writer();
+    person_w.person_id = person_id;
+    person_w.first_name = first_name;
+    person_w.employee = employee;
+    person_w.visitor = visitor;
+    person_w.stranger = stranger;
+    person_w.entry_time = c_default_entry_time;
+    person_w.leave_time = c_default_leave_time;
+    return insert_person(person_w);
+}
+
+person_t insert_person(person_writer& person_w)
+{
+    person_t new_person = person_t::get(person_w.insert_row());
+
+    id_index::persons().insert(person_w.person_id, new_person.gaia_id());
+    active_events::add_person(new_person.gaia_id());
+    admission_scheduler::add_person(new_person.gaia_id(), person_w.entry_time, person_w.leave_time);
+
+    return new_person;
+}
+
+building_t add_building(uint64_t building_id, std::string name)
+{
+    auto building_w = building_writer();
+    building_w.building_id = building_id;
+    building_w.name = name;
+    building_t new_building = building_t::get(building_w.insert_row());
+
+    id_index::buildings().insert(building_id, new_building.gaia_id());
+
+    return new_building;
+}
+
+void populate_all_tables()
+{
+    using namespace gaia::access_control;
+
+    helpers::set_time(480);
+
+    person_t john = add_person(1, "John", true, false, false);
+    person_t jane = add_person(2, "Jane", false, true, false);
+    person_t stranger = add_person(3, "Mr. Stranger", false, false, true);
+
+    // Headquarters building.
+    building_t headquarters = add_building(10, "HQ Building");
+
+    room_t room;
+    event_t event;
+
+    room = add_room(102, "Auditorium", 200, headquarters);
+    event = add_event("Happy hour", 720, 840, room);
+    add_registration(john, event);
+    add_registration(jane, event);
+
+    room = add_room(104, "Big Room", 4, headquarters);
+    event = add_event("The best meeting", 660, 720, room);
+    event = add_event("Boring meeting", 600, 660, room);
+    add_registration(john, event);
+    add_registration(jane, event);
+
+    room = add_room(103, "Little Room", 3, headquarters);
+    event = add_event("Important meeting", 540, 600, room);
+    add_registration(john, event);
+}
+
+// Deletes one row, disconnecting it from its related rows first. Rows are
+// deleted parents first, so children are already disconnected from them.
+
+void delete_building(gaia::common::gaia_id_t id)
+{
+    auto building = building_t::get(id);
+    building.rooms().clear();
+    building.parked_people().clear();
+    building.people_entered().clear();
+    building.scans().clear();
+    building.delete_row();
+}
+
+void delete_room(gaia::common::gaia_id_t id)
+{
+    auto room = room_t::get(id);
+    room.people_inside().clear();
+    room.permissions().clear();
+    room.events().clear();
+    room.scans().clear();
+    room.delete_row();
+}
+
+void delete_person(gaia::common::gaia_id_t id)
+{
+    auto person = person_t::get(id);
+    person.permitted_in().clear();
+    person.registrations().clear();
+    person.vehicles().clear();
+    person.scans().clear();
+    person.delete_row();
+}
+
+void delete_event(gaia::common::gaia_id_t id)
+{
+    auto event = event_t::get(id);
+    event.registrations().clear();
+    event.delete_row();
+}
+
+void delete_vehicle(gaia::common::gaia_id_t id)
+{
+    auto vehicle = vehicle_t::get(id);
+    vehicle.scans().clear();
+    vehicle.delete_row();
+}
+
+template <typename T_row>
+void delete_leaf(gaia::common::gaia_id_t id)
+{
+    T_row::get(id).delete_row();
+}
+
+struct pending_delete_t
+{
+    void (*delete_row)(gaia::common::gaia_id_t);
+    gaia::common::gaia_id_t id;
+};
+
+template <typename T_row>
+void list_rows(void (*delete_row)(gaia::common::gaia_id_t), std::vector<pending_delete_t>& rows)
+{
+    for (const auto& row : T_row::list())
+    {
+        rows.push_back({delete_row, row.gaia_id()});
+    }
+}
+
+// Deletes the app_metadata row, which marks the tables as current. Tables
+// are always wiped after it, so that tables left half-wiped by a crash are
+// not reused by --startup keep.
+void delete_schema_marker()
+{
+    std::vector<pending_delete_t> rows;
+    list_rows<app_metadata_t>(delete_leaf<app_metadata_t>, rows);
+    for (const pending_delete_t& row : rows)
+    {
+        row.delete_row(row.id);
+    }
+}
+
+// Every row of the database but the schema marker, in deletion order, from
+// one pass per table.
+std::vector<pending_delete_t> list_all_rows()
+{
+    std::vector<pending_delete_t> rows;
+    list_rows<building_t>(delete_building, rows);
+    list_rows<room_t>(delete_room, rows);
+    list_rows<person_t>(delete_person, rows);
+    list_rows<permitted_room_t>(delete_leaf<permitted_room_t>, rows);
+    list_rows<event_t>(delete_event, rows);
+    list_rows<registration_t>(delete_leaf<registration_t>, rows);
+    list_rows<vehicle_t>(delete_vehicle, rows);
+    list_rows<scan_t>(delete_leaf<scan_t>, rows);
+    list_rows<scan_rollup_t>(delete_leaf<scan_rollup_t>, rows);
+    return rows;
+}
+
+void reset_indexes()
+{
+    id_index::clear_all();
+    active_events::clear();
+    admission_scheduler::clear();
+    occupancy::clear();
+    scan_retention::clear();
+    ui::clear_changes();
+}
+
+void clear_all_tables()
+{
+    delete_schema_marker();
+    for (const pending_delete_t& row : list_all_rows())
+    {
+        row.delete_row(row.id);
+    }
+    reset_indexes();
+}
+
+void truncate_all_tables()
+{
+    gaia::db::begin_transaction();
+    delete_schema_marker();
+    gaia::db::commit_transaction();
+
+    gaia::db::begin_transaction();
+    std::vector<pending_delete_t> rows = list_all_rows();
+    gaia::db::commit_transaction();
+
+    for (size_t batch_start = 0; batch_start < rows.size(); batch_start += c_truncate_batch_size)
+    {
+        size_t batch_end = std::min(rows.size(), batch_start + c_truncate_batch_size);
+        gaia::db::begin_transaction();
+        for (size_t i = batch_start; i < batch_end; i++)
+        {
+            rows[i].delete_row(rows[i].id);
+        }
+        gaia::db::commit_transaction();
+    }
+    reset_indexes();
+}
+
+bool has_current_schema()
+{
+    auto metadata = *app_metadata_t::list().begin();
+    return metadata && metadata.schema_version() == c_schema_version;
+}
+
+void mark_schema_current()
+{
+    for (auto metadata = *app_metadata_t::list().begin(); metadata; metadata = *app_metadata_t::list().begin())
+    {
+        metadata.delete_row();
+    }
+    app_metadata_t::insert_row(c_schema_version, helpers::get_time_now());
+}
+
+// Records the application clock with the persisted data, so that
+// --startup keep resumes at the same time. Must be called outside a
+// transaction.
+void save_time()
+{
+    gaia::db::begin_transaction();
+    auto metadata = *app_metadata_t::list().begin();
+    if (metadata)
+    {
+        auto metadata_w = metadata.writer();
+        metadata_w.app_time = helpers::get_time_now();
+        metadata_w.update_row();
+    }
+    gaia::db::commit_transaction();
+}
+
+void rebuild_indexes()
+{
+    id_index::clear_all();
+    active_events::clear();
+    admission_scheduler::clear();
+    occupancy::clear();
+
+    // Events and entry windows are scheduled relative to the clock, so it
+    // is restored first.
+    auto metadata = *app_metadata_t::list().begin();
+    if (metadata)
+    {
+        helpers::set_time(metadata.app_time());
+    }
+
+    for (const auto& building : building_t::list())
+    {
+        id_index::buildings().insert(building.building_id(), building.gaia_id());
+    }
+    for (const auto& room : room_t::list())
+    {
+        id_index::rooms().insert(room.room_id(), room.gaia_id());
+    }
+    for (const auto& person : person_t::list())
+    {
+        if (person.inside_room())
+        {
+            occupancy::enter_room(person.gaia_id(), person.inside_room().gaia_id(), 0);
+        }
+        if (person.entered_building())
+        {
+            occupancy::enter_building(person.gaia_id(), person.entered_building().gaia_id());
+        }
+
+        // Strangers detected by the rules are inserted without a person_id,
+        // and are not indexed when they are created either.
+        if (person.person_id() == 0)
+        {
+            continue;
+        }
+        id_index::persons().insert(person.person_id(), person.gaia_id());
+        active_events::add_person(person.gaia_id());
+        admission_scheduler::add_person(person.gaia_id(), person.entry_time(), person.leave_time());
+    }
+    // People are tracked by now, so their registrations are picked up.
+    for (const auto& event : event_t::list())
+    {
+        auto room = event.held_in_room();
+        active_events::add_event(
+            event.gaia_id(), room ? room.gaia_id() : gaia::common::c_invalid_gaia_id,
+            event.start_timestamp(), event.end_timestamp());
+        for (const auto& registration : event.registrations())
+        {
+            if (registration.registered())
+            {
+                active_events::add_registration(registration.registered().gaia_id(), event.gaia_id());
+            }
+        }
+    }
+
+    ui::clear_changes();
+}
+
+bool get_person(uint64_t person_id, person_t& person)
+{
+    gaia::common::gaia_id_t gaia_id;
+    if (!id_index::persons().find(person_id, gaia_id))
+    {
+        return false;
+    }
+
+    person = person_t::get(gaia_id);
+    return true;
+}
+
+bool get_room(uint64_t room_id, room_t& room)
+{
+    gaia::common::gaia_id_t gaia_id;
+    if (!id_index::rooms().find(room_id, gaia_id))
+    {
+        return false;
+    }
+
+    room = room_t::get(gaia_id);
+    return true;
+}
+
+bool get_building(uint64_t building_id, building_t& building)
+{
+    gaia::common::gaia_id_t gaia_id;
+    if (!id_index::buildings().find(building_id, gaia_id))
+    {
+        return false;
+    }
+
+    building = building_t::get(gaia_id);
+    return true;
+}
+
+// Slow path for payloads that scan_parser::parse() does not handle.
+// Returns false if scan_type is missing, not a string or unknown; throws
+// json::exception if person_id is missing or an ID is not an unsigned
+// integer.
+bool parse_scan_message(const json& j, scan_message_t& scan)
+{
+    scan = {};
+    auto scan_type = j.find("scan_type");
+    if (scan_type == j.end() || !scan_type->is_string()
+        || !scan_parser::scan_type_from_string(scan_type->get<std::string>(), scan.scan_type))
+    {
+        return false;
+    }
+
+    scan.person_id = j.at("person_id").get<uint64_t>();
+
+    auto room_id = j.find("room_id");
+    if (room_id != j.end() && !room_id->is_null())
+    {
+        scan.has_room_id = true;
+        scan.room_id = room_id->get<uint64_t>();
+    }
+
+    auto building_id = j.find("building_id");
+    if (building_id != j.end() && !building_id->is_null())
+    {
+        scan.has_building_id = true;
+        scan.building_id = building_id->get<uint64_t>();
+    }
+
+    return true;
+}
+
+// Must be called inside a transaction.
+gaia::common::gaia_id_t add_scan(const scan_message_t& scan)
+{
+    auto scan_w = scan_writer();
+    scan_w.scan_type = scan.scan_type;
+    scan_w.timestamp = scan.timestamp;
+    scan_w.face_signature = std::string(scan.get_face_signature());
+    scan_w.license = std::string(scan.get_license());
+
+    scan_t new_scan = scan_t::get(scan_w.insert_row());
+
+    person_t person;
+    room_t room;
+    building_t building;
+    bool has_person;
+    bool has_room;
+    bool has_building;
+    {
+        metrics::stage_timer_t lookup_timer(metrics::stage_t::lookup);
+        has_person = get_person(scan.person_id, person);
+        has_room = scan.has_room_id && get_room(scan.room_id, room);
+        has_building = scan.has_building_id && get_building(scan.building_id, building);
+    }
+
+    if (has_person)
+    {
+        person.scans().insert(new_scan);
+    }
+
+    if (has_room)
+    {
+        room.scans().insert(new_scan);
+        room.building().scans().insert(new_scan);
+    }
+
+    if (has_building)
+    {
+        building.scans().insert(new_scan);
+    }
+
+    return new_scan.gaia_id();
+}
+
+// Inserts a whole batch of scans in one transaction. The rules fire once
+// the batch commits.
+bool add_scans(const std::vector<scan_message_t>& scans)
+{
+    bool links_shared_rows = std::any_of(scans.begin(), scans.end(), [](const scan_message_t& scan) {
+        return scan.has_room_id || scan.has_building_id;
+    });
+
+    std::vector<gaia::common::gaia_id_t> scan_ids;
+    for (uint32_t attempt = 1;; attempt++)
+    {
+        try
+        {
+            scan_ids.clear();
+            {
+                std::unique_lock shared_link_lock(g_shared_link_lock, std::defer_lock);
+                if (links_shared_rows)
+                {
+                    shared_link_lock.lock();
+                }
+
+                gaia::db::begin_transaction();
+                for (const scan_message_t& scan : scans)
+                {
+                    scan_ids.push_back(add_scan(scan));
+                }
+                metrics::stage_timer_t commit_timer(metrics::stage_t::commit);
+                gaia::db::commit_transaction();
+            }
+            break;
+        }
+        catch (const gaia::db::transaction_update_conflict&)
+        {
+            if (attempt == c_scan_batch_warning_attempts)
+            {
+                gaia_log::app().warn("A batch of {} scans conflicted {} times; still retrying.",
+                    scans.size(), attempt);
+            }
+            std::this_thread::sleep_for(std::min(c_scan_batch_retry_backoff * attempt, c_max_scan_batch_retry_backoff));
+        }
+        catch (const std::exception& e)
+        {
+            if (gaia::db::is_transaction_open())
+            {
+                gaia::db::rollback_transaction();
+            }
+            gaia_log::app().error("Dropped a batch of {} scans: {}", scans.size(), e.what());
+            metrics::count(metrics::counter_t::scans_dropped, scans.size());
+            return false;
+        }
+    }
+
+    // The batch is committed, so a failure from here on is not a drop.
+    try
+    {
+        scan_retention::add_scans(scan_ids);
+        for (size_t i = 0; i < scans.size(); i++)
+        {
+            const scan_message_t& scan = scans[i];
+            audit_log::record(
+                audit_log::outcome_t::received, scan_ids[i], scan.scan_type, scan.person_id,
+                scan.has_room_id ? scan.room_id : 0, scan.has_building_id ? scan.building_id : 0);
+        }
+    }
+    catch (const std::exception& e)
+    {
+        gaia_log::app().error("Could not track a committed batch of {} scans: {}", scans.size(), e.what());
+    }
+    return true;
+}
+
+void submit_scan(const scan_message_t& scan)
+{
+    metrics::count_scan(scan.scan_type);
+
+    // Fibonacci hashing spreads consecutive person IDs across workers.
+    uint64_t hash = scan.person_id * 0x9E3779B97F4A7C15ull;
+    g_scan_batchers[(hash >> 32) % g_scan_batchers.size()]->submit(scan);
+}
+
+void flush_scans()
+{
+    for (auto& scan_batcher : g_scan_batchers)
+    {
+        scan_batcher->flush();
+    }
+}
+
+std::vector<std::string> split_topic(const std::string& topic)
+{
+    std::vector<std::string> result;
+    size_t left = 0;
+    size_t right = topic.find('/');
+    while (right != std::string::npos)
+    {
+        result.push_back(topic.substr(left, right - left));
+        left = right + 1;
+        right = topic.find('/', left);
+    }
+    result.push_back(topic.substr(left));
+    return result;
+}
+
+void message_callback(const std::string &topic, const std::string &payload)
+{
+    std::vector<std::string> topic_vector = split_topic(topic);
+    if (gaia_log::app().is_debug_enabled())
+    {
+        gaia_log::app().debug("Received topic: {} | payload: {}", topic, payload);
+    }
+    
+    if (topic_vector.size() < 3 || topic_vector.at(1) != "access_control")
+    {
+        gaia_log::app().error("Unexpected topic: {}", topic);
+        return;
+    }
+
+    if (topic_vector.at(2) == "time")
+    {
+        int64_t time = std::stoll(payload);
+        if (time < 0)
+        {
+            gaia_log::app().error("Tried to set a negative time: {}", time);
+        }
+        else
+        {
+            // Scans received before the time update must see the old time.
+            flush_scans();
+            helpers::set_time(time);
+            save_time();
+        }
+    }
+    else if (topic_vector.at(2) == "ui_sync")
+    {
+        ui::request_full_snapshot();
+    }
+    else if (topic_vector.at(2) == "init_sync")
+    {
+        communication::publish_message("access_control/init", *ui::get_cached_init_message());
+    }
+    else if (topic_vector.at(2) == "scan")
+    {
+        scan_message_t scan;
+        {
+            metrics::stage_timer_t parse_timer(metrics::stage_t::parse);
+            if (!scan_parser::parse(payload, scan))
+            {
+                try
+                {
+                    if (!parse_scan_message(json::parse(payload), scan))
+                    {
+                        gaia_log::app().error("Malformed scan payload: missing or unknown scan_type.");
+                        return;
+                    }
+                }
+                catch (const json::exception& e)
+                {
+                    gaia_log::app().error("Malformed scan payload: {}", e.what());
+                    return;
+                }
+            }
+        }
+        submit_scan(scan);
+    }
+    else if (topic_vector.at(2) == "scan_bin")
+    {
+        scan_message_t scan;
+        {
+            metrics::stage_timer_t parse_timer(metrics::stage_t::parse);
+            if (!scan_binary::decode_record(payload, scan))
+            {
+                gaia_log::app().error("Malformed binary scan record of {} bytes.", payload.size());
+                return;
+            }
+        }
+        submit_scan(scan);
+    }
+    else if (topic_vector.at(2) == "scan_bin_batch")
+    {
+        // A batch with any invalid record is rejected as a whole.
+        std::vector<scan_message_t> scans;
+        if (!scan_binary::decode_batch(payload, scans))
+        {
+            gaia_log::app().error("Malformed binary scan batch of {} bytes.", payload.size());
+            return;
+        }
+        for (const scan_message_t& scan : scans)
+        {
+            submit_scan(scan);
+        }
+    }
+    else
+    {
+        gaia_log::app().error("Unexpected topic: {}", topic);
+        return;
+    }
+}
+
+bool start_workers(bool is_replaying)
+{
+    std::string audit_directory = config::get_option("--audit-dir", "");
+    if (!audit_directory.empty()
+        && !audit_log::start(
+            audit_directory,
+            config::get_uint_option("--audit-segment-records", c_default_audit_segment_records)))
+    {
+        return false;
+    }
+
+    uint64_t scan_retention_ms = config::get_uint_option("--scan-retention-ms", c_default_scan_retention_ms);
+    if (scan_retention_ms > 0)
+    {
+        scan_retention::start(
+            std::chrono::milliseconds(scan_retention_ms), config::get_uint_option("--scan-rollup", 0) != 0);
+    }
+
+    uint64_t scan_worker_count = std::max<uint64_t>(config::get_uint_option("--scan-workers", 1), 1);
+    if (is_replaying && scan_worker_count > 1)
+    {
+        gaia_log::app().warn("Replaying with one scan worker instead of {}, to keep scans in trace order.", scan_worker_count);
+        scan_worker_count = 1;
+    }
+    for (uint64_t i = 0; i < scan_worker_count; i++)
+    {
+        g_scan_batchers.push_back(std::make_unique<scan_batcher_t>(
+            config::get_uint_option("--scan-batch-size", c_default_scan_batch_size),
+            std::chrono::microseconds(
+                config::get_uint_option("--scan-batch-latency-us", c_default_scan_batch_latency_us)),
+            add_scans));
+        g_scan_batchers.back()->start();
+    }
+
+    uint64_t ui_delta_interval_ms = config::get_uint_option(
+        "--ui-delta-interval-ms", c_default_ui_delta_interval_ms);
+    if (ui_delta_interval_ms > 0)
+    {
+        ui::start_delta_publisher(
+            std::chrono::milliseconds(ui_delta_interval_ms),
+            std::chrono::milliseconds(
+                config::get_uint_option("--ui-snapshot-interval-ms", c_default_ui_snapshot_interval_ms)));
+    }
+
+    uint64_t publish_coalesce_us = config::get_uint_option(
+        "--publish-coalesce-us", c_default_publish_coalesce_us);
+    if (publish_coalesce_us > 0)
+    {
+        communication::start_publish_coalescing(std::chrono::microseconds(publish_coalesce_us));
+    }
+
+    ingest::backpressure_policy_t backpressure_policy;
+    std::string backpressure = config::get_option("--ingest-backpressure", c_default_ingest_backpressure);
+    if (!ingest::parse_backpressure_policy(backpressure, backpressure_policy))
+    {
+        gaia_log::app().error("Unknown backpressure policy '{}'.", backpressure);
+        return false;
+    }
+    if (is_replaying && backpressure_policy != ingest::backpressure_policy_t::block)
+    {
+        gaia_log::app().warn("Replaying with blocking backpressure instead of '{}', so that no message is dropped.", backpressure);
+        backpressure_policy = ingest::backpressure_policy_t::block;
+    }
+    ingest::start(
+        message_callback,
+        config::get_uint_option("--ingest-queue-capacity", c_default_ingest_queue_capacity),
+        backpressure_policy);
+
+    g_rule_profile_path = config::get_option("--profile-rules", "");
+    if (!g_rule_profile_path.empty())
+    {
+        rule_profiler::enable();
+    }
+
+    uint64_t metrics_interval_ms = config::get_uint_option("--metrics-interval-ms", c_default_metrics_interval_ms);
+    if (metrics_interval_ms > 0)
+    {
+        metrics::start_exporter(
+            std::chrono::milliseconds(metrics_interval_ms), config::get_option("--metrics-file", ""));
+    }
+
+    return true;
+}
+
+void stop_workers()
+{
+    ingest::stop();
+    for (auto& scan_batcher : g_scan_batchers)
+    {
+        scan_batcher->stop();
+    }
+    g_scan_batchers.clear();
+    scan_retention::stop();
+    ui::stop_delta_publisher();
+    metrics::stop_exporter();
+
+    if (!g_rule_profile_path.empty())
+    {
+        rule_profiler::write_report(g_rule_profile_path);
+        g_rule_profile_path.clear();
+    }
+}
+
+void stop_rule_outputs()
+{
+    // Rules record their decisions until the end.
+    audit_log::stop();
+    communication::stop_publish_coalescing();
+}
@@ -0,0 +1,290 @@
+/////////////////////////////////////////////
+// Copyright (c) Gaia Platform LLC
+// All rights reserved.
+/////////////////////////////////////////////
+
+#include "audit_log.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "gaia/logger.hpp"
+
+#include "helpers.hpp"
+#include "rule_profiler.hpp"
+
+using namespace gaia::access_control;
+
+namespace audit_log
+{
+
+const char c_segment_prefix[] = "audit-";
+const char c_segment_suffix[] = ".log";
+
+static_assert(static_cast<size_t>(rule_profiler::rule_t::count) <= c_no_rule);
+
+std::mutex g_lock;
+std::condition_variable g_has_records;
+std::vector<audit_record_t> g_pending_records;
+bool g_is_started = false;
+bool g_is_stopping = false;
+std::thread g_writer;
+
+// Only touched by the writer thread, and by start() before it runs.
+std::string g_directory;
+uint64_t g_segment_record_count = 0;
+uint64_t g_segment_sequence = 0;
+uint64_t g_records_in_segment = 0;
+int g_segment_fd = -1;
+
+std::string get_segment_path(uint64_t sequence)
+{
+    char name[64];
+    snprintf(name, sizeof(name), "%s%010lu%s", c_segment_prefix, static_cast<unsigned long>(sequence),
+        c_segment_suffix);
+    return (std::filesystem::path(g_directory) / name).string();
+}
+
+bool open_segment(uint64_t sequence)
+{
+    std::string path = get_segment_path(sequence);
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_APPEND, 0644);
+    if (fd < 0)
+    {
+        gaia_log::app().error("Could not create audit segment '{}': {}", path, strerror(errno));
+        return false;
+    }
+
+    g_segment_fd = fd;
+    g_segment_sequence = sequence;
+    g_records_in_segment = 0;
+    return true;
+}
+
+void close_segment()
+{
+    if (g_segment_fd >= 0)
+    {
+        fdatasync(g_segment_fd);
+        close(g_segment_fd);
+        g_segment_fd = -1;
+    }
+}
+
+bool write_all(int fd, const void* data, size_t size)
+{
+    const char* bytes = static_cast<const char*>(data);
+    while (size > 0)
+    {
+        ssize_t written = write(fd, bytes, size);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return false;
+        }
+        bytes += written;
+        size -= written;
+    }
+    return true;
+}
+
+// Appends the records, moving to new segments as they fill up, then syncs
+// the current segment.
+void write_records(const std::vector<audit_record_t>& records)
+{
+    size_t next = 0;
+    while (next < records.size() && g_segment_fd >= 0)
+    {
+        if (g_records_in_segment == g_segment_record_count)
+        {
+            close_segment();
+            if (!open_segment(g_segment_sequence + 1))
+            {
+                break;
+            }
+        }
+
+        size_t count = std::min<size_t>(records.size() - next, g_segment_record_count - g_records_in_segment);
+        if (!write_all(g_segment_fd, &records[next], count * sizeof(audit_record_t)))
+        {
+            gaia_log::app().error("Could not write the audit log: {}", strerror(errno));
+            break;
+        }
+        g_records_in_segment += count;
+        next += count;
+    }
+
+    if (next < records.size())
+    {
+        gaia_log::app().error("Dropped {} audit records.", records.size() - next);
+    }
+
+    if (g_segment_fd >= 0)
+    {
+        fdatasync(g_segment_fd);
+    }
+}
+
+void run_writer()
+{
+    std::vector<audit_record_t> records;
+
+    std::unique_lock lock(g_lock);
+    while (true)
+    {
+        g_has_records.wait(lock, [] { return !g_pending_records.empty() || g_is_stopping; });
+        if (g_pending_records.empty())
+        {
+            break;
+        }
+
+        records.swap(g_pending_records);
+        lock.unlock();
+        write_records(records);
+        records.clear();
+        lock.lock();
+    }
+}
+
+// The sequence after the highest one already in the directory.
+uint64_t get_next_sequence()
+{
+    uint64_t next_sequence = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(g_directory))
+    {
+        std::string name = entry.path().filename().string();
+        unsigned long sequence;
+        if (sscanf(name.c_str(), "audit-%lu.log", &sequence) == 1 && sequence >= next_sequence)
+        {
+            next_sequence = sequence + 1;
+        }
+    }
+    return next_sequence;
+}
+
+bool start(const std::string& directory, uint64_t segment_record_count)
+{
+    g_directory = directory;
+    g_segment_record_count = std::max<uint64_t>(segment_record_count, 1);
+
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if (error)
+    {
+        gaia_log::app().error("Could not create audit directory '{}': {}", directory, error.message());
+        return false;
+    }
+
+    if (!open_segment(get_next_sequence()))
+    {
+        return false;
+    }
+
+    std::lock_guard lock(g_lock);
+    g_is_stopping = false;
+    g_is_started = true;
+    g_writer = std::thread(run_writer);
+    return true;
+}
+
+void stop()
+{
+    {
+        std::lock_guard lock(g_lock);
+        if (!g_is_started)
+        {
+            return;
+        }
+        g_is_started = false;
+        g_is_stopping = true;
+    }
+    g_has_records.notify_one();
+
+    if (g_writer.joinable())
+    {
+        g_writer.join();
+    }
+    close_segment();
+}
+
+audit_record_t make_record(
+    outcome_t outcome, gaia::common::gaia_id_t scan_id, uint8_t scan_type,
+    uint64_t person_id, uint64_t room_id, uint64_t building_id)
+{
+    audit_record_t record{};
+    record.app_time = helpers::get_time_now();
+    record.person_id = person_id;
+    record.room_id = room_id;
+    record.building_id = building_id;
+    record.scan_id = scan_id;
+    record.scan_type = scan_type;
+    record.outcome = outcome;
+    record.rule = c_no_rule;
+    return record;
+}
+
+void append(audit_record_t record)
+{
+    bool was_empty;
+    {
+        std::lock_guard lock(g_lock);
+        if (!g_is_started)
+        {
+            return;
+        }
+        record.wall_time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        was_empty = g_pending_records.empty();
+        g_pending_records.push_back(record);
+    }
+
+    // The writer only sleeps while there is nothing to write.
+    if (was_empty)
+    {
+        g_has_records.notify_one();
+    }
+}
+
+void record(
+    outcome_t outcome, gaia::common::gaia_id_t scan_id, uint8_t scan_type,
+    uint64_t person_id, uint64_t room_id, uint64_t building_id)
+{
+    append(make_record(outcome, scan_id, scan_type, person_id, room_id, building_id));
+}
+
+void record_decision(gaia::common::gaia_id_t scan_id, outcome_t outcome)
+{
+    auto scan = scan_t::get(scan_id);
+    auto person = scan.seen_who_person();
+    auto room = scan.seen_in_room();
+    auto building = scan.seen_at_building();
+
+    audit_record_t record = make_record(
+        outcome, scan_id, scan.scan_type(),
+        person ? person.person_id() : 0,
+        room ? room.room_id() : 0,
+        building ? building.building_id() : 0);
+
+    const rule_profiler::scope_t* scope = rule_profiler::get_current_scope();
+    if (scope)
+    {
+        record.rule = static_cast<uint8_t>(scope->get_rule());
+        record.invocation_id = scope->get_invocation_id();
+    }
+    append(record);
+}
+
+} // namespace audit_log
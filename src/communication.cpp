@@ -6,26 +6,22 @@
 #include "communication.hpp"
 
 #include <chrono>
+#include <cstdlib>
+#include <memory>
 
-#include <iostream>
-#include <limits>
-#include <vector>
-
-#include <aws/crt/Api.h>
-#include <aws/crt/StlAllocator.h>
 #include <aws/crt/UUID.h>
-#include <aws/crt/auth/Credentials.h>
-#include <aws/iot/MqttClient.h>
 
 #include "gaia/logger.hpp"
-#include "gaia/system.hpp"
 
-using namespace Aws::Crt;
+#include "config.hpp"
+#include "loopback_transport.hpp"
+#include "metrics.hpp"
+#include "mqtt_transport.hpp"
+#include "publish_coalescer.hpp"
+
 using namespace std;
 using namespace gaia::access_control;
 
-
-
 namespace gaia
 {
 namespace access_control
@@ -33,47 +29,68 @@ namespace access_control
 namespace communication
 {
 
-std::shared_ptr<Aws::Crt::Mqtt::MqttConnection> g_connection;
-
-string g_endpoint;
-string g_region;
-string g_remote_client_id;
+std::unique_ptr<transport_t> g_transport;
 
 string get_uuid()
 {
     return Aws::Crt::UUID().ToString().c_str();
 }
 
+// Read by rule threads while it is started and stopped, so it is only
+// accessed through std::atomic_load() and std::atomic_store(). A rule that
+// still holds a stopped coalescer sends through it directly.
+std::shared_ptr<publish_coalescer_t> g_publish_coalescer;
+
+void send_message(const string& topic, const string& payload)
+{
+    if (g_transport)
+    {
+        metrics::stage_timer_t publish_timer(metrics::stage_t::publish);
+        g_transport->publish(topic, payload);
+        metrics::count(metrics::counter_t::publishes);
+    }
+}
+
 void publish_message(const string& topic, const string& payload)
 {
-    auto on_publish_complete = [](Mqtt::MqttConnection&, uint16_t packet_id, int error_code)
+    auto publish_coalescer = std::atomic_load(&g_publish_coalescer);
+    if (publish_coalescer)
+    {
+        publish_coalescer->publish(topic, payload);
+    }
+    else
     {
-        if (packet_id)
-        {
-            gaia_log::app().trace("Operation on packet_id {} Succeeded", packet_id);
-        }
-        else
-        {
-            gaia_log::app().error("Operation failed with error {}", aws_error_debug_str(error_code));
-        }
-    };
+        send_message(topic, payload);
+    }
+}
 
-    if (g_connection)
+void start_publish_coalescing(std::chrono::microseconds window)
+{
+    auto publish_coalescer = std::make_shared<publish_coalescer_t>(window, send_message);
+    publish_coalescer->start();
+    std::atomic_store(&g_publish_coalescer, publish_coalescer);
+}
+
+void stop_publish_coalescing()
+{
+    auto publish_coalescer = std::atomic_exchange(&g_publish_coalescer, std::shared_ptr<publish_coalescer_t>());
+    if (publish_coalescer)
     {
-        ByteBuf payload_buf = ByteBufFromArray(reinterpret_cast<const uint8_t*>(payload.c_str()), payload.length());
-        string full_topic = g_remote_client_id + "/" + topic;
-        gaia_log::app().info("Publishing on topic:{} payload:{}", full_topic, payload);
-        g_connection->Publish(full_topic.c_str(), AWS_MQTT_QOS_AT_LEAST_ONCE, false, payload_buf, on_publish_complete);
+        publish_coalescer->stop();
+        gaia_log::app().info("Publish coalescing saved {} messages.", publish_coalescer->get_coalesced_count());
     }
 }
 
 void print_help()
 {
     fprintf(stdout, "Usage:\n");
-    fprintf(stdout, "access_control --endpoint <endpoint> --region <region> --gateway-id <gateway-id>\n\n");
+    fprintf(stdout, "access_control --endpoint <endpoint> --region <region> --remote-client-id <remote-client-id>\n");
+    fprintf(stdout, "access_control --transport loopback\n\n");
     fprintf(stdout, "endpoint: the endpoint of the mqtt server not including a port\n");
     fprintf(stdout, "region: aws region (e.g. us-west-2)\n");
     fprintf(stdout, "remote-client-id: mqtt client id of simulator or other publisher/subscriber of messages\n");
+    fprintf(stdout, "transport: mqtt (the default) or loopback, which reads messages from stdin and\n");
+    fprintf(stdout, "           writes published messages to stdout\n");
 }
 
 void print_aws_creds_error()
@@ -83,27 +100,20 @@ void print_aws_creds_error()
         " AWS_ACCESS_KEY_ID, AWS_SECRET_ACCESS_KEY, and AWS_SESSION_TOKEN");
 }
 
-bool cmd_option_exists(char** begin, char** end, const String& option)
+bool init(int, char*[])
 {
-    return find(begin, end, option) != end;
-}
-
-char* get_cmd_option(char** begin, char** end, const String& option)
-{
-    char** itr = find(begin, end, option);
-    if (itr != end && ++itr != end)
+    /*********************** Parse Arguments ***************************/
+    string transport = config::get_option("--transport", "mqtt");
+    if (transport == "loopback")
     {
-        return *itr;
+        g_transport = std::make_unique<loopback_transport_t>();
+        return true;
     }
-    return 0;
-}
 
-bool init(int argc, char* argv[])
-{
-    /*********************** Parse Arguments ***************************/
-    if (!cmd_option_exists(argv, argv + argc, "--endpoint")
-        || !cmd_option_exists(argv, argv + argc, "--region")
-        || !cmd_option_exists(argv, argv + argc, "--remote-client-id"))
+    if (transport != "mqtt"
+        || !config::option_exists("--endpoint")
+        || !config::option_exists("--region")
+        || !config::option_exists("--remote-client-id"))
     {
         print_help();
         return false;
@@ -116,180 +126,37 @@ bool init(int argc, char* argv[])
         return false;
     }
 
-    g_endpoint = get_cmd_option(argv, argv + argc, "--endpoint");
-    g_region = get_cmd_option(argv, argv + argc, "--region");
-    g_remote_client_id = get_cmd_option(argv, argv + argc, "--remote-client-id");
+    g_transport = std::make_unique<mqtt_transport_t>(
+        config::get_option("--endpoint", ""),
+        config::get_option("--region", ""),
+        config::get_option("--remote-client-id", ""));
 
     return true;
 }
 
-void connect(message_callback_t callback, const std::string& init_msg)
+void set_transport(std::unique_ptr<transport_t> transport)
 {
-    string client_id = get_uuid();
-    string subscribe_topic = client_id + "/#";
-
-    ApiHandle api_handle;
-
-    Io::EventLoopGroup event_loop_group(1);
-    if (!event_loop_group)
-    {
-        gaia_log::app().error("Event Loop Group Creation failed with error {}", ErrorDebugString(event_loop_group.LastError()));
-        exit(-1);
-    }
-
-    Aws::Crt::Io::DefaultHostResolver default_host_resolver(event_loop_group, 1, 5);
-    Io::ClientBootstrap bootstrap(event_loop_group, default_host_resolver);
-
-    if (!bootstrap)
-    {
-        gaia_log::app().error("ClientBootstrap failed with error {}", ErrorDebugString(bootstrap.LastError()));
-        exit(-1);
-    }
-
-    std::shared_ptr<Aws::Crt::Auth::ICredentialsProvider> provider = nullptr;
-
-    Aws::Crt::Auth::CredentialsProviderStaticConfig config;
-    config.AccessKeyId = Aws::Crt::ByteCursorFromCString(getenv("AWS_ACCESS_KEY_ID"));
-    config.SecretAccessKey = Aws::Crt::ByteCursorFromCString(getenv("AWS_SECRET_ACCESS_KEY"));
-    config.SessionToken = Aws::Crt::ByteCursorFromCString(getenv("AWS_SESSION_TOKEN"));
-
-    provider = Aws::Crt::Auth::CredentialsProvider::CreateCredentialsProviderStatic(config);
-
-    Aws::Iot::MqttClientConnectionConfigBuilder builder;
-    Aws::Iot::WebsocketConfig ws_config(g_region.c_str(), provider);
-    builder = Aws::Iot::MqttClientConnectionConfigBuilder(ws_config);
-    builder.WithEndpoint(g_endpoint.c_str());
-
-    auto client_config = builder.Build();
-    if (!client_config)
-    {
-        gaia_log::app().error("Client Configuration initialization failed with error {}", ErrorDebugString(client_config.LastError()));
-        exit(-1);
-    }
-
-    Aws::Iot::MqttClient mqtt_client(bootstrap);
-
-    if (!mqtt_client)
-    {
-        gaia_log::app().error("MQTT Client Creation failed with error {}", ErrorDebugString(mqtt_client.LastError()));
-        exit(-1);
-    }
-
-    g_connection = mqtt_client.NewConnection(client_config);
-
-    if (!g_connection)
-    {
-        gaia_log::app().error("MQTT Connection Creation failed with error {}", ErrorDebugString(mqtt_client.LastError()));
-        exit(-1);
-    }
-
-    std::promise<bool> connection_completed_promise;
-    std::promise<void> connection_closed_promise;
-
-    auto on_connection_completed = [&](Mqtt::MqttConnection&, int error_code, Mqtt::ReturnCode return_code, bool)
-    {
-        if (error_code)
-        {
-            gaia_log::app().error("Connection failed with error {}", ErrorDebugString(error_code));
-            connection_completed_promise.set_value(false);
-        }
-        else
-        {
-            if (return_code != AWS_MQTT_CONNECT_ACCEPTED)
-            {
-                gaia_log::app().error("Connection failed with mqtt return code {}", (int)return_code);
-                connection_completed_promise.set_value(false);
-            }
-            else
-            {
-                gaia_log::app().info("Connection completed successfully.");
-                gaia::system::initialize();
-                connection_completed_promise.set_value(true);
-            }
-        }
-    };
-
-    auto on_interrupted = [&](Mqtt::MqttConnection&, int error)
-    {
-        gaia_log::app().error("Connection interrupted with error {}", ErrorDebugString(error));
-    };
-
-    auto on_resumed = [&](Mqtt::MqttConnection&, Mqtt::ReturnCode, bool)
-    { gaia_log::app().info("Connection resumed"); };
-
-    auto on_disconnect = [&](Mqtt::MqttConnection&)
-    {
-        {
-            gaia_log::app().info("Disconnect completed");
-            gaia::system::shutdown();
-            connection_closed_promise.set_value();
-        }
-    };
-
-    auto on_message = [&](Mqtt::MqttConnection&, const String& topic, const ByteBuf& payload,
-                          bool /*dup*/, Mqtt::QOS /*qos*/, bool /*retain*/)
-    {
-        callback(string(topic.c_str()), string(reinterpret_cast<char*>(payload.buffer), payload.len));
-    };
+    g_transport = std::move(transport);
+}
 
-    g_connection->OnConnectionCompleted = std::move(on_connection_completed);
-    g_connection->OnDisconnect = std::move(on_disconnect);
-    g_connection->OnConnectionInterrupted = std::move(on_interrupted);
-    g_connection->OnConnectionResumed = std::move(on_resumed);
+void set_publish_sink(publish_sink_t sink)
+{
+    g_transport = std::make_unique<loopback_transport_t>(sink);
+}
 
-    gaia_log::app().info("Connecting...");
-    if (!g_connection->Connect(client_id.c_str(), false, 1000))
-    {
-        gaia_log::app().error("MQTT Connection failed with error {}", ErrorDebugString(g_connection->LastError()));
-        exit(-1);
-    }
+void connect(message_callback_t callback, const std::string& init_msg)
+{
+    string client_id = get_uuid();
 
-    if (connection_completed_promise.get_future().get())
+    if (g_transport->connect(client_id, callback))
     {
-        std::promise<void> subscribe_finished_promise;
-        auto on_sub_ack =
-            [&](Mqtt::MqttConnection&, uint16_t packet_id, const String& topic, Mqtt::QOS qos, int error_code)
-        {
-            if (error_code)
-            {
-                gaia_log::app().error("Subscribe failed with error {}", aws_error_debug_str(error_code));
-                exit(-1);
-            }
-            else
-            {
-                if (!packet_id || qos == AWS_MQTT_QOS_FAILURE)
-                {
-                    gaia_log::app().error("Subscribe rejected by the broker.");
-                    exit(-1);
-                }
-                else
-                {
-                    gaia_log::app().info("Subscribe on topic {} on packet_id {} Succeeded", topic.c_str(), packet_id);
-                }
-            }
-            subscribe_finished_promise.set_value();
-        };
-
-        g_connection->Subscribe(subscribe_topic.c_str(), AWS_MQTT_QOS_AT_LEAST_ONCE, on_message, on_sub_ack);
-        subscribe_finished_promise.get_future().wait();
         publish_message("appUUID", client_id);
         publish_message("access_control/init", init_msg);
 
-        String input;
-        gaia_log::app().info("Waiting to connect to the Sandbox...");
-        std::getline(std::cin, input);
-
-        std::promise<void> unsubscribe_finished_promise;
-        g_connection->Unsubscribe(
-            "#", [&](Mqtt::MqttConnection&, uint16_t, int)
-            { unsubscribe_finished_promise.set_value(); });
-        unsubscribe_finished_promise.get_future().wait();
+        g_transport->run();
     }
 
-    if (g_connection->Disconnect())
-    {
-        connection_closed_promise.get_future().wait();
-    }
+    g_transport->disconnect();
 }
 
 } // namespace communication
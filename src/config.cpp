@@ -0,0 +1,57 @@
+/////////////////////////////////////////////
+// Copyright (c) Gaia Platform LLC
+// All rights reserved.
+/////////////////////////////////////////////
+
+#include "config.hpp"
+
+#include <algorithm>
+#include <vector>
+
+#include "gaia/logger.hpp"
+
+namespace config
+{
+
+std::vector<std::string> g_args;
+
+void init(int argc, char* argv[])
+{
+    g_args.assign(argv, argv + argc);
+}
+
+bool option_exists(const std::string& option)
+{
+    return std::find(g_args.begin(), g_args.end(), option) != g_args.end();
+}
+
+std::string get_option(const std::string& option, const std::string& default_value)
+{
+    auto iter = std::find(g_args.begin(), g_args.end(), option);
+    if (iter != g_args.end() && ++iter != g_args.end())
+    {
+        return *iter;
+    }
+    return default_value;
+}
+
+uint64_t get_uint_option(const std::string& option, uint64_t default_value)
+{
+    std::string value = get_option(option, "");
+    if (value.empty())
+    {
+        return default_value;
+    }
+
+    try
+    {
+        return std::stoull(value);
+    }
+    catch (const std::exception&)
+    {
+        gaia_log::app().error("Invalid value '{}' for option {}, using {}.", value, option, default_value);
+        return default_value;
+    }
+}
+
+} // namespace config
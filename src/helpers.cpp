@@ -3,8 +3,14 @@
 #include <random>
 #include <vector>
 
+#include "active_events.hpp"
+#include "admission_scheduler.hpp"
+#include "audit_log.hpp"
 #include "communication.hpp"
 #include "helpers.hpp"
+#include "occupancy.hpp"
+#include "rule_profiler.hpp"
+#include "ui.hpp"
 
 using namespace gaia::access_control;
 
@@ -46,6 +52,12 @@ bool helpers::person_has_registrations(gaia::common::gaia_id_t person_id)
 
 bool helpers::person_has_event_now(gaia::common::gaia_id_t person_id)
 {
+    bool has_event;
+    if (active_events::find_active_event(person_id, gaia::common::c_invalid_gaia_id, has_event))
+    {
+        return has_event;
+    }
+
     auto person = gaia::access_control::person_t::get(person_id);
 
     for(auto registration : person.registrations())
@@ -64,6 +76,13 @@ bool helpers::person_has_event_now(
     gaia::common::gaia_id_t person_id,
     gaia::access_control::room_t room)
 {
+    bool has_event;
+    if (active_events::find_active_event(
+            person_id, room ? room.gaia_id() : gaia::common::c_invalid_gaia_id, has_event))
+    {
+        return has_event;
+    }
+
     auto person = gaia::access_control::person_t::get(person_id);
 
     for(auto registration : person.registrations())
@@ -113,6 +132,13 @@ void helpers::disconnect_person_from_room(gaia::common::gaia_id_t person_id)
         std::string building_id = std::to_string(person.inside_room().building().building_id());
         std::string topic = "access_control/" + std::to_string(person.person_id()) + "/move_to_building";
 
+        ui::mark_person_changed(person_id);
+        ui::mark_room_changed(person.inside_room().gaia_id());
+        ui::mark_building_changed(person.inside_room().building().gaia_id());
+
+        occupancy::leave_room(person_id, person.inside_room().gaia_id());
+        rule_profiler::wrote(person_id);
+        rule_profiler::wrote(person.inside_room().gaia_id());
         person.inside_room().people_inside().remove(person);
 
         // Move the person back into the building but not a specific room.
@@ -124,6 +150,12 @@ void helpers::disconnect_person_from_building(gaia::common::gaia_id_t person_id)
 {
     auto person = gaia::access_control::person_t::get(person_id);
     if (person.entered_building()) {
+        ui::mark_person_changed(person_id);
+        ui::mark_building_changed(person.entered_building().gaia_id());
+
+        occupancy::leave_building(person_id, person.entered_building().gaia_id());
+        rule_profiler::wrote(person_id);
+        rule_profiler::wrote(person.entered_building().gaia_id());
         person.entered_building().people_entered().remove(person);
 
         std::string topic = "access_control/" + std::to_string(person.person_id()) + "/move_to_building";
@@ -147,6 +179,19 @@ void helpers::delete_their_room_permissions(gaia::common::gaia_id_t person_id)
     }
 }
 
+bool helpers::claim_room_place(
+    gaia::common::gaia_id_t person_id,
+    gaia::common::gaia_id_t scan_id)
+{
+    auto room = gaia::access_control::scan_t::get(scan_id).seen_in_room();
+    if (!room)
+    {
+        return true;
+    }
+
+    return occupancy::enter_room(person_id, room.gaia_id(), room.capacity());
+}
+
 void helpers::let_them_in(
     gaia::common::gaia_id_t person_id,
     gaia::common::gaia_id_t scan_id)
@@ -158,6 +203,10 @@ void helpers::let_them_in(
     {
         disconnect_person_from_room(person_id);
         scan.seen_in_room().people_inside().insert(person);
+        occupancy::enter_room(person_id, scan.seen_in_room().gaia_id(), 0);
+        rule_profiler::wrote(scan.seen_in_room().gaia_id());
+        ui::mark_person_changed(person_id);
+        ui::mark_room_changed(scan.seen_in_room().gaia_id());
         
         std::string building_and_room = std::to_string(scan.seen_at_building().building_id());
         building_and_room.append(",");
@@ -169,6 +218,10 @@ void helpers::let_them_in(
     if (scan.seen_at_building())
     {
         scan.seen_at_building().people_entered().insert(person);
+        occupancy::enter_building(person_id, scan.seen_at_building().gaia_id());
+        rule_profiler::wrote(scan.seen_at_building().gaia_id());
+        ui::mark_person_changed(person_id);
+        ui::mark_building_changed(scan.seen_at_building().gaia_id());
 
         if(!scan.seen_in_room())
         {
@@ -177,6 +230,15 @@ void helpers::let_them_in(
             communication::publish_message(topic, building_id);
         }
     }
+
+    if (scan.seen_in_room())
+    {
+        audit_log::record_decision(scan_id, audit_log::outcome_t::admitted_to_room);
+    }
+    else if (scan.seen_at_building())
+    {
+        audit_log::record_decision(scan_id, audit_log::outcome_t::admitted_to_building);
+    }
 }
 
 gaia::access_control::person_t helpers::insert_stranger(std::string face_signature)
@@ -216,6 +278,8 @@ uint64_t g_current_time = 0;
 void helpers::set_time(uint64_t time)
 {
     g_current_time = time;
+    active_events::set_time(time);
+    admission_scheduler::set_time(time);
 }
 
 uint64_t helpers::get_time_now()
@@ -0,0 +1,75 @@
+/////////////////////////////////////////////
+// Copyright (c) Gaia Platform LLC
+// All rights reserved.
+/////////////////////////////////////////////
+
+#include "id_index.hpp"
+
+#include <mutex>
+
+namespace id_index
+{
+
+bool id_map_t::find(uint64_t external_id, gaia::common::gaia_id_t& gaia_id) const
+{
+    std::shared_lock lock(m_lock);
+    auto iter = m_map.find(external_id);
+    if (iter == m_map.end())
+    {
+        return false;
+    }
+
+    gaia_id = iter->second;
+    return true;
+}
+
+void id_map_t::insert(uint64_t external_id, gaia::common::gaia_id_t gaia_id)
+{
+    std::unique_lock lock(m_lock);
+    m_map[external_id] = gaia_id;
+}
+
+void id_map_t::erase(uint64_t external_id)
+{
+    std::unique_lock lock(m_lock);
+    m_map.erase(external_id);
+}
+
+void id_map_t::clear()
+{
+    std::unique_lock lock(m_lock);
+    m_map.clear();
+}
+
+size_t id_map_t::size() const
+{
+    std::shared_lock lock(m_lock);
+    return m_map.size();
+}
+
+id_map_t& persons()
+{
+    static id_map_t s_persons;
+    return s_persons;
+}
+
+id_map_t& rooms()
+{
+    static id_map_t s_rooms;
+    return s_rooms;
+}
+
+id_map_t& buildings()
+{
+    static id_map_t s_buildings;
+    return s_buildings;
+}
+
+void clear_all()
+{
+    persons().clear();
+    rooms().clear();
+    buildings().clear();
+}
+
+} // namespace id_index
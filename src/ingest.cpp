@@ -0,0 +1,220 @@
+/////////////////////////////////////////////
+// Copyright (c) Gaia Platform LLC
+// All rights reserved.
+/////////////////////////////////////////////
+
+#include "ingest.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "actions.hpp"
+#include "bounded_queue.hpp"
+
+#include "gaia/db/db.hpp"
+#include "gaia/logger.hpp"
+
+namespace ingest
+{
+
+// The worker re-checks the queue at least this often, in case it missed a
+// wake-up.
+constexpr std::chrono::milliseconds c_idle_wait{10};
+
+// Producers blocked on a full queue back off for this long between tries.
+constexpr std::chrono::microseconds c_full_queue_backoff{50};
+
+// Rejection alerts are published at most this often.
+constexpr std::chrono::seconds c_rejection_alert_interval{1};
+
+struct message_t
+{
+    std::string topic;
+    std::string payload;
+};
+
+gaia::access_control::communication::message_callback_t g_handler;
+backpressure_policy_t g_policy;
+std::unique_ptr<bounded_queue_t<message_t>> g_queue;
+
+std::atomic<uint64_t> g_enqueued_count{0};
+std::atomic<uint64_t> g_processed_count{0};
+std::atomic<uint64_t> g_dropped_count{0};
+std::atomic<uint64_t> g_rejected_count{0};
+std::atomic<uint64_t> g_failed_count{0};
+std::atomic<size_t> g_max_depth{0};
+std::atomic<int64_t> g_last_rejection_alert_ns{0};
+
+std::mutex g_worker_lock;
+std::condition_variable g_work_available;
+std::atomic<bool> g_is_worker_idle{false};
+bool g_is_stopping = false;
+std::thread g_worker;
+
+bool parse_backpressure_policy(const std::string& name, backpressure_policy_t& policy)
+{
+    if (name == "block")
+    {
+        policy = backpressure_policy_t::block;
+    }
+    else if (name == "drop_oldest")
+    {
+        policy = backpressure_policy_t::drop_oldest;
+    }
+    else if (name == "reject")
+    {
+        policy = backpressure_policy_t::reject;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+void worker()
+{
+    gaia::db::begin_session();
+
+    message_t message;
+    while (true)
+    {
+        if (g_queue->try_pop(message))
+        {
+            // Messages come from remote peers, so one that makes the handler
+            // throw is logged and skipped rather than ending the process.
+            try
+            {
+                g_handler(message.topic, message.payload);
+            }
+            catch (const std::exception& e)
+            {
+                if (gaia::db::is_transaction_open())
+                {
+                    gaia::db::rollback_transaction();
+                }
+                gaia_log::app().error("Failed to handle a message on topic {}: {}", message.topic, e.what());
+                g_failed_count++;
+            }
+            g_processed_count++;
+            continue;
+        }
+
+        std::unique_lock lock(g_worker_lock);
+        if (g_is_stopping)
+        {
+            break;
+        }
+
+        g_is_worker_idle = true;
+        g_work_available.wait_for(lock, c_idle_wait, [] { return g_queue->size() > 0 || g_is_stopping; });
+        g_is_worker_idle = false;
+    }
+
+    gaia::db::end_session();
+}
+
+void start(
+    gaia::access_control::communication::message_callback_t handler,
+    size_t capacity,
+    backpressure_policy_t policy)
+{
+    g_handler = handler;
+    g_policy = policy;
+    g_queue = std::make_unique<bounded_queue_t<message_t>>(capacity);
+    g_is_stopping = false;
+    g_worker = std::thread(worker);
+}
+
+void stop()
+{
+    if (!g_worker.joinable())
+    {
+        return;
+    }
+
+    {
+        std::lock_guard lock(g_worker_lock);
+        g_is_stopping = true;
+    }
+    g_work_available.notify_one();
+    g_worker.join();
+
+    stats_t stats = get_stats();
+    gaia_log::app().info(
+        "Ingest queue: {} enqueued, {} processed, {} failed, {} dropped, {} rejected, max depth {}/{}.",
+        stats.enqueued_count, stats.processed_count, stats.failed_count, stats.dropped_count, stats.rejected_count,
+        stats.max_depth, stats.capacity);
+}
+
+void on_rejected()
+{
+    uint64_t rejected_count = ++g_rejected_count;
+
+    int64_t now_ns = std::chrono::steady_clock::now().time_since_epoch().count();
+    int64_t last_alert_ns = g_last_rejection_alert_ns;
+    if (now_ns - last_alert_ns >= std::chrono::nanoseconds(c_rejection_alert_interval).count()
+        && g_last_rejection_alert_ns.compare_exchange_strong(last_alert_ns, now_ns))
+    {
+        actions::ingest_overloaded(rejected_count);
+    }
+}
+
+void enqueue(const std::string& topic, const std::string& payload)
+{
+    message_t message{topic, payload};
+
+    while (!g_queue->try_push(std::move(message)))
+    {
+        switch (g_policy)
+        {
+        case backpressure_policy_t::block:
+            std::this_thread::sleep_for(c_full_queue_backoff);
+            break;
+        case backpressure_policy_t::drop_oldest:
+        {
+            message_t oldest;
+            if (g_queue->try_pop(oldest))
+            {
+                g_dropped_count++;
+            }
+            break;
+        }
+        case backpressure_policy_t::reject:
+            on_rejected();
+            return;
+        }
+    }
+    g_enqueued_count++;
+
+    size_t depth = g_queue->size();
+    size_t max_depth = g_max_depth;
+    while (depth > max_depth && !g_max_depth.compare_exchange_weak(max_depth, depth))
+    {
+    }
+
+    if (g_is_worker_idle)
+    {
+        g_work_available.notify_one();
+    }
+}
+
+stats_t get_stats()
+{
+    stats_t stats;
+    stats.enqueued_count = g_enqueued_count;
+    stats.processed_count = g_processed_count;
+    stats.dropped_count = g_dropped_count;
+    stats.rejected_count = g_rejected_count;
+    stats.failed_count = g_failed_count;
+    stats.depth = g_queue ? g_queue->size() : 0;
+    stats.max_depth = g_max_depth;
+    stats.capacity = g_queue ? g_queue->capacity() : 0;
+    return stats;
+}
+
+} // namespace ingest
@@ -0,0 +1,163 @@
+/////////////////////////////////////////////
+// Copyright (c) Gaia Platform LLC
+// All rights reserved.
+/////////////////////////////////////////////
+
+#include "json_writer.hpp"
+
+#include <charconv>
+
+void json_writer_t::clear()
+{
+    m_buffer.clear();
+    m_has_elements.clear();
+    m_after_key = false;
+}
+
+void json_writer_t::begin_value()
+{
+    if (m_after_key)
+    {
+        m_after_key = false;
+        return;
+    }
+
+    if (!m_has_elements.empty())
+    {
+        if (m_has_elements.back())
+        {
+            m_buffer.push_back(',');
+        }
+        m_has_elements.back() = true;
+    }
+}
+
+void json_writer_t::begin_object()
+{
+    begin_value();
+    m_buffer.push_back('{');
+    m_has_elements.push_back(false);
+}
+
+void json_writer_t::end_object()
+{
+    m_has_elements.pop_back();
+    m_buffer.push_back('}');
+}
+
+void json_writer_t::begin_array()
+{
+    begin_value();
+    m_buffer.push_back('[');
+    m_has_elements.push_back(false);
+}
+
+void json_writer_t::end_array()
+{
+    m_has_elements.pop_back();
+    m_buffer.push_back(']');
+}
+
+void json_writer_t::key(std::string_view name)
+{
+    begin_value();
+    write_string(name);
+    m_buffer.push_back(':');
+    m_after_key = true;
+}
+
+void json_writer_t::value(const char* value)
+{
+    if (!value)
+    {
+        null();
+        return;
+    }
+
+    begin_value();
+    write_string(value);
+}
+
+void json_writer_t::value(std::string_view value)
+{
+    begin_value();
+    write_string(value);
+}
+
+void json_writer_t::value(uint64_t value)
+{
+    begin_value();
+
+    char digits[20];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    m_buffer.append(digits, result.ptr);
+}
+
+void json_writer_t::value(bool value)
+{
+    begin_value();
+    m_buffer.append(value ? "true" : "false");
+}
+
+void json_writer_t::null()
+{
+    begin_value();
+    m_buffer.append("null");
+}
+
+void json_writer_t::raw(std::string_view json)
+{
+    begin_value();
+    m_buffer.append(json);
+}
+
+// Escapes the same characters as nlohmann::json::dump() with ensure_ascii
+// off: quotes, backslashes and control characters. Other bytes, including
+// UTF-8 sequences, are copied as they are.
+void json_writer_t::write_string(std::string_view value)
+{
+    static const char c_hex_digits[] = "0123456789abcdef";
+
+    m_buffer.push_back('"');
+    for (char character : value)
+    {
+        auto byte = static_cast<unsigned char>(character);
+        switch (byte)
+        {
+        case '"':
+            m_buffer.append("\\\"");
+            break;
+        case '\\':
+            m_buffer.append("\\\\");
+            break;
+        case '\b':
+            m_buffer.append("\\b");
+            break;
+        case '\f':
+            m_buffer.append("\\f");
+            break;
+        case '\n':
+            m_buffer.append("\\n");
+            break;
+        case '\r':
+            m_buffer.append("\\r");
+            break;
+        case '\t':
+            m_buffer.append("\\t");
+            break;
+        default:
+            if (byte < 0x20)
+            {
+                m_buffer.append("\\u00");
+                m_buffer.push_back(c_hex_digits[byte >> 4]);
+                m_buffer.push_back(c_hex_digits[byte & 0xf]);
+            }
+            else
+            {
+                m_buffer.push_back(character);
+            }
+            break;
+        }
+    }
+    m_buffer.push_back('"');
+}
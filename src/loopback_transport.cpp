@@ -0,0 +1,82 @@
+/////////////////////////////////////////////
+// Copyright (c) Gaia Platform LLC
+// All rights reserved.
+/////////////////////////////////////////////
+
+#include "loopback_transport.hpp"
+
+#include <iostream>
+
+#include "gaia/logger.hpp"
+
+namespace gaia
+{
+namespace access_control
+{
+namespace communication
+{
+
+loopback_transport_t::loopback_transport_t(publish_sink_t sink)
+    : m_sink(sink)
+{
+}
+
+bool loopback_transport_t::connect(const std::string& client_id, message_callback_t callback)
+{
+    m_client_id = client_id;
+    m_callback = callback;
+    gaia_log::app().info("Using the loopback transport; reading messages from stdin.");
+    return true;
+}
+
+void loopback_transport_t::run()
+{
+    std::string line;
+    while (std::getline(std::cin, line))
+    {
+        if (line.empty())
+        {
+            continue;
+        }
+
+        size_t separator = line.find(' ');
+        if (separator == std::string::npos)
+        {
+            inject(line, "");
+        }
+        else
+        {
+            inject(line.substr(0, separator), line.substr(separator + 1));
+        }
+    }
+}
+
+void loopback_transport_t::publish(const std::string& topic, const std::string& payload)
+{
+    if (m_sink)
+    {
+        m_sink(topic, payload);
+        return;
+    }
+
+    std::lock_guard lock(m_output_lock);
+    std::cout << topic << ' ' << payload << '\n';
+}
+
+void loopback_transport_t::disconnect()
+{
+    std::lock_guard lock(m_output_lock);
+    std::cout.flush();
+}
+
+void loopback_transport_t::inject(const std::string& topic, const std::string& payload)
+{
+    if (m_callback)
+    {
+        m_callback(m_client_id + "/" + topic, payload);
+    }
+}
+
+} // namespace communication
+} // namespace access_control
+} // namespace gaia
@@ -0,0 +1,301 @@
+/////////////////////////////////////////////
+// Copyright (c) Gaia Platform LLC
+// All rights reserved.
+/////////////////////////////////////////////
+
+#include "metrics.hpp"
+
+#include <algorithm>
+#include <cinttypes>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+
+#include "gaia/logger.hpp"
+
+#include "communication.hpp"
+#include "helpers.hpp"
+#include "json_writer.hpp"
+
+namespace metrics
+{
+
+const char c_metrics_topic[] = "access_control/metrics";
+
+const char* const c_stage_names[] = {"parse", "lookup", "commit", "rules", "publish"};
+static_assert(sizeof(c_stage_names) / sizeof(c_stage_names[0]) == static_cast<size_t>(stage_t::count));
+
+const char* const c_counter_names[] = {
+    "strangers_detected",
+    "alerts_no_eligible_events",
+    "alerts_base_credentials_required",
+    "alerts_no_entry_right_now",
+    "alerts_not_this_building",
+    "alerts_not_this_room",
+    "alerts_room_at_capacity",
+    "alerts_ingest_overloaded",
+    "publishes",
+    "publish_failures",
+    "scans_expired",
+    "scans_dropped",
+};
+static_assert(sizeof(c_counter_names) / sizeof(c_counter_names[0]) == static_cast<size_t>(counter_t::count));
+
+std::array<histogram_t, static_cast<size_t>(stage_t::count)> g_stage_histograms;
+std::array<std::atomic<uint64_t>, static_cast<size_t>(counter_t::count)> g_counters{};
+std::array<std::atomic<uint64_t>, c_scan_type_count> g_scan_counters{};
+
+std::thread g_exporter;
+std::mutex g_exporter_lock;
+std::condition_variable g_exporter_stop;
+bool g_is_exporter_stopping = false;
+
+size_t histogram_t::get_bucket_index(uint64_t value)
+{
+    if (value < c_sub_bucket_count)
+    {
+        return value;
+    }
+
+    // The highest set bit selects the power of two, the next
+    // c_sub_bucket_bits bits the bucket within it.
+    size_t shift = 63 - __builtin_clzll(value) - c_sub_bucket_bits;
+    return (shift + 1) * c_sub_bucket_count + ((value >> shift) & (c_sub_bucket_count - 1));
+}
+
+uint64_t histogram_t::get_bucket_upper_bound(size_t index)
+{
+    if (index < c_sub_bucket_count)
+    {
+        return index;
+    }
+
+    size_t shift = index / c_sub_bucket_count - 1;
+    uint64_t mantissa = c_sub_bucket_count + index % c_sub_bucket_count;
+    return ((mantissa + 1) << shift) - 1;
+}
+
+void histogram_t::record(uint64_t value)
+{
+    m_buckets[get_bucket_index(value)].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_sum.fetch_add(value, std::memory_order_relaxed);
+
+    uint64_t max = m_max.load(std::memory_order_relaxed);
+    while (value > max && !m_max.compare_exchange_weak(max, value, std::memory_order_relaxed))
+    {
+    }
+}
+
+uint64_t histogram_t::get_count() const
+{
+    return m_count.load(std::memory_order_relaxed);
+}
+
+uint64_t histogram_t::get_sum() const
+{
+    return m_sum.load(std::memory_order_relaxed);
+}
+
+uint64_t histogram_t::get_max() const
+{
+    return m_max.load(std::memory_order_relaxed);
+}
+
+uint64_t histogram_t::get_percentile(double quantile) const
+{
+    uint64_t count = get_count();
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(quantile * count + 0.5));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < c_bucket_count; i++)
+    {
+        seen += m_buckets[i].load(std::memory_order_relaxed);
+        if (seen >= rank)
+        {
+            return std::min(get_bucket_upper_bound(i), get_max());
+        }
+    }
+    return get_max();
+}
+
+void record_stage(stage_t stage, std::chrono::nanoseconds duration)
+{
+    g_stage_histograms[static_cast<size_t>(stage)].record(duration.count());
+}
+
+void count(counter_t counter, uint64_t amount)
+{
+    g_counters[static_cast<size_t>(counter)].fetch_add(amount, std::memory_order_relaxed);
+}
+
+void count_scan(enums::scan_table::e_scan_type scan_type)
+{
+    if (scan_type < c_scan_type_count)
+    {
+        g_scan_counters[scan_type].fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+const histogram_t& get_stage_histogram(stage_t stage)
+{
+    return g_stage_histograms[static_cast<size_t>(stage)];
+}
+
+uint64_t get_count(counter_t counter)
+{
+    return g_counters[static_cast<size_t>(counter)].load(std::memory_order_relaxed);
+}
+
+std::string get_json_snapshot()
+{
+    json_writer_t writer;
+    writer.begin_object();
+
+    writer.key("counters");
+    writer.begin_object();
+    for (size_t i = 0; i < static_cast<size_t>(counter_t::count); i++)
+    {
+        writer.key(c_counter_names[i]);
+        writer.value(get_count(static_cast<counter_t>(i)));
+    }
+    writer.end_object();
+
+    writer.key("scans");
+    writer.begin_object();
+    for (size_t i = 0; i < c_scan_type_count; i++)
+    {
+        writer.key(helpers::scan_type_string(static_cast<enums::scan_table::e_scan_type>(i)));
+        writer.value(g_scan_counters[i].load(std::memory_order_relaxed));
+    }
+    writer.end_object();
+
+    writer.key("stages");
+    writer.begin_object();
+    for (size_t i = 0; i < static_cast<size_t>(stage_t::count); i++)
+    {
+        const histogram_t& histogram = g_stage_histograms[i];
+        uint64_t count = histogram.get_count();
+
+        writer.key(c_stage_names[i]);
+        writer.begin_object();
+        writer.key("count");
+        writer.value(count);
+        writer.key("mean_ns");
+        writer.value(count ? histogram.get_sum() / count : uint64_t(0));
+        writer.key("p50_ns");
+        writer.value(histogram.get_percentile(0.5));
+        writer.key("p99_ns");
+        writer.value(histogram.get_percentile(0.99));
+        writer.key("p999_ns");
+        writer.value(histogram.get_percentile(0.999));
+        writer.key("max_ns");
+        writer.value(histogram.get_max());
+        writer.end_object();
+    }
+    writer.end_object();
+
+    writer.end_object();
+    return writer.str();
+}
+
+std::string get_text_snapshot()
+{
+    std::string text;
+    char line[256];
+
+    snprintf(
+        line, sizeof(line), "%-10s %12s %12s %12s %12s %12s %12s\n",
+        "stage", "count", "mean_us", "p50_us", "p99_us", "p999_us", "max_us");
+    text += line;
+    for (size_t i = 0; i < static_cast<size_t>(stage_t::count); i++)
+    {
+        const histogram_t& histogram = g_stage_histograms[i];
+        uint64_t count = histogram.get_count();
+        snprintf(
+            line, sizeof(line), "%-10s %12" PRIu64 " %12.1f %12.1f %12.1f %12.1f %12.1f\n",
+            c_stage_names[i], count,
+            count ? histogram.get_sum() / 1000.0 / count : 0.0,
+            histogram.get_percentile(0.5) / 1000.0,
+            histogram.get_percentile(0.99) / 1000.0,
+            histogram.get_percentile(0.999) / 1000.0,
+            histogram.get_max() / 1000.0);
+        text += line;
+    }
+
+    text += "\n";
+    for (size_t i = 0; i < c_scan_type_count; i++)
+    {
+        std::string name = "scans_" + helpers::scan_type_string(static_cast<enums::scan_table::e_scan_type>(i));
+        snprintf(line, sizeof(line), "%-34s %12" PRIu64 "\n", name.c_str(), g_scan_counters[i].load(std::memory_order_relaxed));
+        text += line;
+    }
+    for (size_t i = 0; i < static_cast<size_t>(counter_t::count); i++)
+    {
+        snprintf(line, sizeof(line), "%-34s %12" PRIu64 "\n", c_counter_names[i], get_count(static_cast<counter_t>(i)));
+        text += line;
+    }
+
+    return text;
+}
+
+void export_snapshot(const std::string& dump_path)
+{
+    gaia::access_control::communication::publish_message(c_metrics_topic, get_json_snapshot());
+
+    if (dump_path.empty())
+    {
+        return;
+    }
+
+    // Written aside and renamed, so readers never see a partial dump.
+    std::string temporary_path = dump_path + ".tmp";
+    FILE* file = fopen(temporary_path.c_str(), "w");
+    if (!file)
+    {
+        gaia_log::app().error("Could not write metrics to '{}'.", temporary_path);
+        return;
+    }
+    std::string text = get_text_snapshot();
+    fwrite(text.data(), 1, text.size(), file);
+    fclose(file);
+    rename(temporary_path.c_str(), dump_path.c_str());
+}
+
+void start_exporter(std::chrono::milliseconds interval, const std::string& dump_path)
+{
+    g_is_exporter_stopping = false;
+    g_exporter = std::thread([interval, dump_path] {
+        std::unique_lock lock(g_exporter_lock);
+        while (!g_exporter_stop.wait_for(lock, interval, [] { return g_is_exporter_stopping; }))
+        {
+            lock.unlock();
+            export_snapshot(dump_path);
+            lock.lock();
+        }
+
+        lock.unlock();
+        export_snapshot(dump_path);
+    });
+}
+
+void stop_exporter()
+{
+    {
+        std::lock_guard lock(g_exporter_lock);
+        g_is_exporter_stopping = true;
+    }
+    g_exporter_stop.notify_one();
+
+    if (g_exporter.joinable())
+    {
+        g_exporter.join();
+    }
+}
+
+} // namespace metrics
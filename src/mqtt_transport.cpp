@@ -0,0 +1,251 @@
+/////////////////////////////////////////////
+// Copyright (c) Gaia Platform LLC
+// All rights reserved.
+/////////////////////////////////////////////
+
+#include "mqtt_transport.hpp"
+
+#include <iostream>
+
+#include <aws/crt/auth/Credentials.h>
+
+#include "gaia/logger.hpp"
+#include "gaia/system.hpp"
+
+#include "metrics.hpp"
+
+using namespace Aws::Crt;
+using namespace std;
+
+namespace gaia
+{
+namespace access_control
+{
+namespace communication
+{
+
+mqtt_transport_t::mqtt_transport_t(string endpoint, string region, string remote_client_id)
+    : m_endpoint(std::move(endpoint))
+    , m_region(std::move(region))
+    , m_remote_client_id(std::move(remote_client_id))
+{
+}
+
+bool mqtt_transport_t::connect(const string& client_id, message_callback_t callback)
+{
+    string subscribe_topic = client_id + "/#";
+
+    m_api_handle = std::make_unique<ApiHandle>();
+
+    m_event_loop_group = std::make_unique<Io::EventLoopGroup>(1);
+    if (!*m_event_loop_group)
+    {
+        gaia_log::app().error("Event Loop Group Creation failed with error {}", ErrorDebugString(m_event_loop_group->LastError()));
+        exit(-1);
+    }
+
+    m_host_resolver = std::make_unique<Io::DefaultHostResolver>(*m_event_loop_group, 1, 5);
+    m_bootstrap = std::make_unique<Io::ClientBootstrap>(*m_event_loop_group, *m_host_resolver);
+
+    if (!*m_bootstrap)
+    {
+        gaia_log::app().error("ClientBootstrap failed with error {}", ErrorDebugString(m_bootstrap->LastError()));
+        exit(-1);
+    }
+
+    std::shared_ptr<Aws::Crt::Auth::ICredentialsProvider> provider = nullptr;
+
+    Aws::Crt::Auth::CredentialsProviderStaticConfig config;
+    config.AccessKeyId = Aws::Crt::ByteCursorFromCString(getenv("AWS_ACCESS_KEY_ID"));
+    config.SecretAccessKey = Aws::Crt::ByteCursorFromCString(getenv("AWS_SECRET_ACCESS_KEY"));
+    config.SessionToken = Aws::Crt::ByteCursorFromCString(getenv("AWS_SESSION_TOKEN"));
+
+    provider = Aws::Crt::Auth::CredentialsProvider::CreateCredentialsProviderStatic(config);
+
+    Aws::Iot::MqttClientConnectionConfigBuilder builder;
+    Aws::Iot::WebsocketConfig ws_config(m_region.c_str(), provider);
+    builder = Aws::Iot::MqttClientConnectionConfigBuilder(ws_config);
+    builder.WithEndpoint(m_endpoint.c_str());
+
+    auto client_config = builder.Build();
+    if (!client_config)
+    {
+        gaia_log::app().error("Client Configuration initialization failed with error {}", ErrorDebugString(client_config.LastError()));
+        exit(-1);
+    }
+
+    m_mqtt_client = std::make_unique<Aws::Iot::MqttClient>(*m_bootstrap);
+
+    if (!*m_mqtt_client)
+    {
+        gaia_log::app().error("MQTT Client Creation failed with error {}", ErrorDebugString(m_mqtt_client->LastError()));
+        exit(-1);
+    }
+
+    m_connection = m_mqtt_client->NewConnection(client_config);
+
+    if (!m_connection)
+    {
+        gaia_log::app().error("MQTT Connection Creation failed with error {}", ErrorDebugString(m_mqtt_client->LastError()));
+        exit(-1);
+    }
+
+    // The callbacks stay installed on m_connection after connect() returns,
+    // so they share the promises they complete instead of referring to
+    // this stack frame.
+    auto connection_completed_promise = std::make_shared<std::promise<bool>>();
+
+    auto on_connection_completed = [connection_completed_promise](
+                                       Mqtt::MqttConnection&, int error_code, Mqtt::ReturnCode return_code, bool)
+    {
+        if (error_code)
+        {
+            gaia_log::app().error("Connection failed with error {}", ErrorDebugString(error_code));
+            connection_completed_promise->set_value(false);
+        }
+        else
+        {
+            if (return_code != AWS_MQTT_CONNECT_ACCEPTED)
+            {
+                gaia_log::app().error("Connection failed with mqtt return code {}", (int)return_code);
+                connection_completed_promise->set_value(false);
+            }
+            else
+            {
+                gaia_log::app().info("Connection completed successfully.");
+                gaia::system::initialize();
+                connection_completed_promise->set_value(true);
+            }
+        }
+    };
+
+    auto on_interrupted = [](Mqtt::MqttConnection&, int error)
+    {
+        gaia_log::app().error("Connection interrupted with error {}", ErrorDebugString(error));
+    };
+
+    auto on_resumed = [](Mqtt::MqttConnection&, Mqtt::ReturnCode, bool)
+    { gaia_log::app().info("Connection resumed"); };
+
+    // The database is shut down by the caller once its workers have
+    // drained, not here.
+    auto on_disconnect = [this](Mqtt::MqttConnection&)
+    {
+        gaia_log::app().info("Disconnect completed");
+        m_connection_closed_promise.set_value();
+    };
+
+    auto on_message = [callback](Mqtt::MqttConnection&, const String& topic, const ByteBuf& payload,
+                                 bool /*dup*/, Mqtt::QOS /*qos*/, bool /*retain*/)
+    {
+        callback(string(topic.c_str()), string(reinterpret_cast<char*>(payload.buffer), payload.len));
+    };
+
+    m_connection->OnConnectionCompleted = std::move(on_connection_completed);
+    m_connection->OnDisconnect = std::move(on_disconnect);
+    m_connection->OnConnectionInterrupted = std::move(on_interrupted);
+    m_connection->OnConnectionResumed = std::move(on_resumed);
+
+    gaia_log::app().info("Connecting...");
+    if (!m_connection->Connect(client_id.c_str(), false, 1000))
+    {
+        gaia_log::app().error("MQTT Connection failed with error {}", ErrorDebugString(m_connection->LastError()));
+        exit(-1);
+    }
+
+    if (!connection_completed_promise->get_future().get())
+    {
+        return false;
+    }
+
+    auto subscribe_finished_promise = std::make_shared<std::promise<void>>();
+    auto on_sub_ack = [subscribe_finished_promise](
+                          Mqtt::MqttConnection&, uint16_t packet_id, const String& topic, Mqtt::QOS qos, int error_code)
+    {
+        if (error_code)
+        {
+            gaia_log::app().error("Subscribe failed with error {}", aws_error_debug_str(error_code));
+            exit(-1);
+        }
+        else
+        {
+            if (!packet_id || qos == AWS_MQTT_QOS_FAILURE)
+            {
+                gaia_log::app().error("Subscribe rejected by the broker.");
+                exit(-1);
+            }
+            else
+            {
+                gaia_log::app().info("Subscribe on topic {} on packet_id {} Succeeded", topic.c_str(), packet_id);
+            }
+        }
+        subscribe_finished_promise->set_value();
+    };
+
+    m_connection->Subscribe(subscribe_topic.c_str(), AWS_MQTT_QOS_AT_LEAST_ONCE, on_message, on_sub_ack);
+    subscribe_finished_promise->get_future().wait();
+    m_is_subscribed = true;
+
+    return true;
+}
+
+void mqtt_transport_t::run()
+{
+    String input;
+    gaia_log::app().info("Waiting to connect to the Sandbox...");
+    std::getline(std::cin, input);
+}
+
+void mqtt_transport_t::publish(const string& topic, const string& payload)
+{
+    auto on_publish_complete = [](Mqtt::MqttConnection&, uint16_t packet_id, int error_code)
+    {
+        if (packet_id)
+        {
+            gaia_log::app().trace("Operation on packet_id {} Succeeded", packet_id);
+        }
+        else
+        {
+            gaia_log::app().error("Operation failed with error {}", aws_error_debug_str(error_code));
+            metrics::count(metrics::counter_t::publish_failures);
+        }
+    };
+
+    if (m_connection)
+    {
+        // Reused across calls, so building the full topic does not allocate.
+        thread_local string full_topic;
+        full_topic.assign(m_remote_client_id).append("/").append(topic);
+
+        ByteBuf payload_buf = ByteBufFromArray(reinterpret_cast<const uint8_t*>(payload.c_str()), payload.length());
+        gaia_log::app().info("Publishing on topic:{} payload:{}", full_topic, payload);
+        m_connection->Publish(full_topic.c_str(), AWS_MQTT_QOS_AT_LEAST_ONCE, false, payload_buf, on_publish_complete);
+    }
+}
+
+void mqtt_transport_t::disconnect()
+{
+    if (!m_connection)
+    {
+        return;
+    }
+
+    if (m_is_subscribed)
+    {
+        auto unsubscribe_finished_promise = std::make_shared<std::promise<void>>();
+        m_connection->Unsubscribe(
+            "#", [unsubscribe_finished_promise](Mqtt::MqttConnection&, uint16_t, int)
+            { unsubscribe_finished_promise->set_value(); });
+        unsubscribe_finished_promise->get_future().wait();
+        m_is_subscribed = false;
+    }
+
+    if (m_connection->Disconnect())
+    {
+        m_connection_closed_promise.get_future().wait();
+    }
+}
+
+} // namespace communication
+} // namespace access_control
+} // namespace gaia
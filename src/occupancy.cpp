@@ -0,0 +1,127 @@
+/////////////////////////////////////////////
+// Copyright (c) Gaia Platform LLC
+// All rights reserved.
+/////////////////////////////////////////////
+
+#include "occupancy.hpp"
+
+#include <mutex>
+#include <unordered_map>
+
+namespace occupancy
+{
+
+using gaia::common::gaia_id_t;
+
+// Where each person is counted, and how many people are counted in each
+// place. Rooms and buildings get a tally_t each.
+struct tally_t
+{
+    std::unordered_map<gaia_id_t, gaia_id_t> place_by_person;
+    std::unordered_map<gaia_id_t, uint32_t> count_by_place;
+
+    void remove(gaia_id_t place_id)
+    {
+        auto count = count_by_place.find(place_id);
+        if (count != count_by_place.end() && --count->second == 0)
+        {
+            count_by_place.erase(count);
+        }
+    }
+
+    uint32_t get_count(gaia_id_t place_id) const
+    {
+        auto count = count_by_place.find(place_id);
+        return count == count_by_place.end() ? 0 : count->second;
+    }
+
+    bool enter(gaia_id_t person_id, gaia_id_t place_id, uint32_t capacity)
+    {
+        auto place = place_by_person.find(person_id);
+        if (place != place_by_person.end() && place->second == place_id)
+        {
+            return true;
+        }
+        if (capacity > 0 && get_count(place_id) >= capacity)
+        {
+            return false;
+        }
+
+        if (place != place_by_person.end())
+        {
+            remove(place->second);
+            place->second = place_id;
+        }
+        else
+        {
+            place_by_person.emplace(person_id, place_id);
+        }
+        count_by_place[place_id]++;
+        return true;
+    }
+
+    void leave(gaia_id_t person_id, gaia_id_t place_id)
+    {
+        auto place = place_by_person.find(person_id);
+        if (place != place_by_person.end() && place->second == place_id)
+        {
+            remove(place_id);
+            place_by_person.erase(place);
+        }
+    }
+
+    void clear()
+    {
+        place_by_person.clear();
+        count_by_place.clear();
+    }
+};
+
+std::mutex g_lock;
+tally_t g_rooms;
+tally_t g_buildings;
+
+bool enter_room(gaia_id_t person_id, gaia_id_t room_id, uint32_t capacity)
+{
+    std::lock_guard lock(g_lock);
+    return g_rooms.enter(person_id, room_id, capacity);
+}
+
+void leave_room(gaia_id_t person_id, gaia_id_t room_id)
+{
+    std::lock_guard lock(g_lock);
+    g_rooms.leave(person_id, room_id);
+}
+
+void enter_building(gaia_id_t person_id, gaia_id_t building_id)
+{
+    std::lock_guard lock(g_lock);
+    g_buildings.enter(person_id, building_id, 0);
+}
+
+void leave_building(gaia_id_t person_id, gaia_id_t building_id)
+{
+    std::lock_guard lock(g_lock);
+    g_buildings.leave(person_id, building_id);
+}
+
+uint32_t get_room_occupancy(gaia_id_t room_id)
+{
+    std::lock_guard lock(g_lock);
+    return g_rooms.get_count(room_id);
+}
+
+uint32_t get_building_occupancy(gaia_id_t building_id)
+{
+    std::lock_guard lock(g_lock);
+    return g_buildings.get_count(building_id);
+}
+
+void clear()
+{
+    std::lock_guard lock(g_lock);
+    g_rooms.clear();
+    g_buildings.clear();
+}
+
+} // namespace occupancy
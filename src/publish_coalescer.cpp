@@ -0,0 +1,149 @@
+/////////////////////////////////////////////
+// Copyright (c) Gaia Platform LLC
+// All rights reserved.
+/////////////////////////////////////////////
+
+#include "publish_coalescer.hpp"
+
+const std::string c_person_topic_prefix = "access_control/";
+const std::string c_move_to_room_suffix = "/move_to_room";
+const std::string c_move_to_building_suffix = "/move_to_building";
+
+publish_coalescer_t::publish_coalescer_t(std::chrono::microseconds window, sink_t sink)
+    : m_window(window), m_sink(std::move(sink))
+{
+}
+
+publish_coalescer_t::~publish_coalescer_t()
+{
+    stop();
+}
+
+static bool ends_with(const std::string& text, const std::string& suffix)
+{
+    return text.size() >= suffix.size()
+        && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+bool publish_coalescer_t::get_state_key(const std::string& topic, std::string& key)
+{
+    if (topic.compare(0, c_person_topic_prefix.size(), c_person_topic_prefix) != 0)
+    {
+        return false;
+    }
+
+    size_t suffix_size;
+    if (ends_with(topic, c_move_to_room_suffix))
+    {
+        suffix_size = c_move_to_room_suffix.size();
+    }
+    else if (ends_with(topic, c_move_to_building_suffix))
+    {
+        suffix_size = c_move_to_building_suffix.size();
+    }
+    else
+    {
+        return false;
+    }
+
+    // "access_control/<person_id>/move_to_..." is keyed by the person ID.
+    key = topic.substr(c_person_topic_prefix.size(), topic.size() - c_person_topic_prefix.size() - suffix_size);
+    return true;
+}
+
+void publish_coalescer_t::start()
+{
+    m_stopping = false;
+    m_is_stopped = false;
+    m_worker = std::thread(&publish_coalescer_t::worker, this);
+}
+
+void publish_coalescer_t::stop()
+{
+    {
+        std::lock_guard lock(m_lock);
+        m_stopping = true;
+    }
+    m_work_available.notify_one();
+
+    if (m_worker.joinable())
+    {
+        m_worker.join();
+    }
+}
+
+void publish_coalescer_t::publish(const std::string& topic, const std::string& payload)
+{
+    std::string state_key;
+    bool is_state = get_state_key(topic, state_key);
+
+    bool is_first;
+    {
+        std::unique_lock lock(m_lock);
+        if (m_is_stopped)
+        {
+            lock.unlock();
+            m_sink(topic, payload);
+            return;
+        }
+
+        is_first = m_pending.empty();
+        if (is_first)
+        {
+            m_window_start = std::chrono::steady_clock::now();
+        }
+
+        if (is_state)
+        {
+            auto [iter, is_new_key] = m_state_positions.try_emplace(state_key, m_pending.size());
+            if (!is_new_key)
+            {
+                m_pending[iter->second].is_superseded = true;
+                iter->second = m_pending.size();
+                m_coalesced_count++;
+            }
+        }
+        m_pending.push_back({topic, payload, false});
+    }
+
+    if (is_first)
+    {
+        m_work_available.notify_one();
+    }
+}
+
+void publish_coalescer_t::worker()
+{
+    std::vector<pending_message_t> batch;
+
+    std::unique_lock lock(m_lock);
+    while (true)
+    {
+        if (m_pending.empty())
+        {
+            if (m_stopping)
+            {
+                m_is_stopped = true;
+                break;
+            }
+            m_work_available.wait(lock, [&] { return !m_pending.empty() || m_stopping; });
+            continue;
+        }
+
+        m_work_available.wait_until(lock, m_window_start + m_window, [&] { return m_stopping; });
+
+        batch.swap(m_pending);
+        m_state_positions.clear();
+
+        lock.unlock();
+        for (const pending_message_t& message : batch)
+        {
+            if (!message.is_superseded)
+            {
+                m_sink(message.topic, message.payload);
+            }
+        }
+        batch.clear();
+        lock.lock();
+    }
+}
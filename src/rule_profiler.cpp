@@ -0,0 +1,222 @@
+/////////////////////////////////////////////
+// Copyright (c) Gaia Platform LLC
+// All rights reserved.
+/////////////////////////////////////////////
+
+#include "rule_profiler.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cinttypes>
+#include <cstdio>
+#include <iostream>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "gaia/logger.hpp"
+
+#include "metrics.hpp"
+
+namespace rule_profiler
+{
+
+const char* const c_rule_names[] = {
+    "on_insert(scan)",
+    "on_update(scan)",
+    "on_update(person)",
+    "on_update(room)",
+    "on_update(event)",
+    "@badge_scan",
+    "@joining_wifi",
+    "@leaving_wifi",
+    "@vehicle_entering",
+    "@vehicle_departing",
+    "@face_scan without credentials",
+    "@badged || @parked || @on_wifi",
+    "@face_scan by an employee",
+    "@face_scan by a visitor",
+    "@face_scan while inadmissible",
+    "on_change(scan.leaving)",
+};
+static_assert(sizeof(c_rule_names) / sizeof(c_rule_names[0]) == static_cast<size_t>(rule_t::count));
+
+// The depth map is dropped when it grows past this many rows; the next
+// rules then start new chains at depth 1.
+constexpr size_t c_max_tracked_rows = 1 << 20;
+
+struct rule_stats_t
+{
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> total_ns{0};
+    std::atomic<uint64_t> max_ns{0};
+    std::array<std::atomic<uint64_t>, c_max_tracked_depth + 1> depth_counts{};
+};
+
+std::atomic<bool> g_is_enabled{false};
+std::array<rule_stats_t, static_cast<size_t>(rule_t::count)> g_rule_stats;
+
+// Cascade depth of the rule that last wrote each row.
+std::mutex g_depth_lock;
+std::unordered_map<gaia::common::gaia_id_t, uint32_t> g_row_depths;
+
+// The innermost scope open on this thread.
+thread_local scope_t* g_current_scope = nullptr;
+
+std::atomic<uint64_t> g_last_invocation_id{0};
+
+void enable()
+{
+    g_is_enabled = true;
+}
+
+bool is_enabled()
+{
+    return g_is_enabled.load(std::memory_order_relaxed);
+}
+
+scope_t::scope_t(rule_t rule, gaia::common::gaia_id_t trigger_id)
+    : m_outer(g_current_scope), m_rule(rule), m_invocation_id(++g_last_invocation_id),
+      m_start(std::chrono::steady_clock::now())
+{
+    g_current_scope = this;
+
+    if (!is_enabled())
+    {
+        return;
+    }
+
+    uint32_t trigger_depth = 0;
+    {
+        std::lock_guard lock(g_depth_lock);
+        auto it = g_row_depths.find(trigger_id);
+        if (it != g_row_depths.end())
+        {
+            trigger_depth = it->second;
+        }
+    }
+    m_depth = std::min(trigger_depth + 1, c_max_tracked_depth);
+}
+
+scope_t::~scope_t()
+{
+    g_current_scope = m_outer;
+
+    std::chrono::nanoseconds duration = std::chrono::steady_clock::now() - m_start;
+    metrics::record_stage(metrics::stage_t::rules, duration);
+
+    if (!is_enabled())
+    {
+        return;
+    }
+
+    rule_stats_t& stats = g_rule_stats[static_cast<size_t>(m_rule)];
+    uint64_t duration_ns = duration.count();
+    stats.count.fetch_add(1, std::memory_order_relaxed);
+    stats.total_ns.fetch_add(duration_ns, std::memory_order_relaxed);
+    stats.depth_counts[m_depth].fetch_add(1, std::memory_order_relaxed);
+
+    uint64_t max_ns = stats.max_ns.load(std::memory_order_relaxed);
+    while (duration_ns > max_ns && !stats.max_ns.compare_exchange_weak(max_ns, duration_ns, std::memory_order_relaxed))
+    {
+    }
+}
+
+void scope_t::wrote(gaia::common::gaia_id_t row_id)
+{
+    if (!is_enabled())
+    {
+        return;
+    }
+
+    std::lock_guard lock(g_depth_lock);
+    if (g_row_depths.size() >= c_max_tracked_rows)
+    {
+        g_row_depths.clear();
+    }
+    g_row_depths[row_id] = m_depth;
+}
+
+void wrote(gaia::common::gaia_id_t row_id)
+{
+    if (g_current_scope)
+    {
+        g_current_scope->wrote(row_id);
+    }
+}
+
+const scope_t* get_current_scope()
+{
+    return g_current_scope;
+}
+
+std::string get_report()
+{
+    std::vector<size_t> rules;
+    for (size_t i = 0; i < static_cast<size_t>(rule_t::count); i++)
+    {
+        if (g_rule_stats[i].count > 0)
+        {
+            rules.push_back(i);
+        }
+    }
+    std::sort(rules.begin(), rules.end(), [](size_t left, size_t right) {
+        return g_rule_stats[left].total_ns > g_rule_stats[right].total_ns;
+    });
+
+    std::string report;
+    char line[256];
+
+    snprintf(
+        line, sizeof(line), "%-32s %10s %10s %9s %9s  %s\n",
+        "rule", "count", "total_ms", "mean_us", "max_us", "depth:count");
+    report += line;
+
+    for (size_t i : rules)
+    {
+        const rule_stats_t& stats = g_rule_stats[i];
+        uint64_t count = stats.count;
+        snprintf(
+            line, sizeof(line), "%-32s %10" PRIu64 " %10.1f %9.1f %9.1f ",
+            c_rule_names[i], count, stats.total_ns / 1e6, stats.total_ns / 1e3 / count, stats.max_ns / 1e3);
+        report += line;
+
+        for (uint32_t depth = 1; depth <= c_max_tracked_depth; depth++)
+        {
+            uint64_t depth_count = stats.depth_counts[depth];
+            if (depth_count > 0)
+            {
+                snprintf(
+                    line, sizeof(line), " %" PRIu32 "%s:%" PRIu64, depth,
+                    depth == c_max_tracked_depth ? "+" : "", depth_count);
+                report += line;
+            }
+        }
+        report += "\n";
+    }
+
+    return report;
+}
+
+void write_report(const std::string& path)
+{
+    std::string report = get_report();
+    if (path == "-")
+    {
+        std::cout << report << std::flush;
+        return;
+    }
+
+    FILE* file = fopen(path.c_str(), "w");
+    if (!file)
+    {
+        gaia_log::app().error("Could not write the rule profile to '{}'.", path);
+        return;
+    }
+    fwrite(report.data(), 1, report.size(), file);
+    fclose(file);
+    gaia_log::app().info("Wrote the rule profile to '{}'.", path);
+}
+
+} // namespace rule_profiler
@@ -0,0 +1,133 @@
+/////////////////////////////////////////////
+// Copyright (c) Gaia Platform LLC
+// All rights reserved.
+/////////////////////////////////////////////
+
+#include "scan_batcher.hpp"
+
+#include <algorithm>
+
+#include "gaia/db/db.hpp"
+
+scan_batcher_t::scan_batcher_t(
+    size_t max_batch_size,
+    std::chrono::microseconds max_latency,
+    flush_callback_t flush_callback)
+    : m_max_batch_size(max_batch_size ? max_batch_size : 1)
+    , m_max_latency(max_latency)
+    , m_flush_callback(std::move(flush_callback))
+{
+    m_pending.reserve(m_max_batch_size);
+}
+
+scan_batcher_t::~scan_batcher_t()
+{
+    stop();
+}
+
+void scan_batcher_t::start()
+{
+    m_stopping = false;
+    m_worker = std::thread(&scan_batcher_t::worker, this);
+}
+
+void scan_batcher_t::stop()
+{
+    {
+        std::lock_guard lock(m_lock);
+        m_stopping = true;
+    }
+    m_work_available.notify_one();
+
+    if (m_worker.joinable())
+    {
+        m_worker.join();
+    }
+}
+
+void scan_batcher_t::submit(const scan_message_t& scan)
+{
+    bool should_notify;
+    {
+        std::lock_guard lock(m_lock);
+        if (m_pending.empty())
+        {
+            m_oldest_pending = std::chrono::steady_clock::now();
+        }
+        m_pending.push_back(scan);
+        m_submitted_count++;
+
+        // The worker only needs waking to start a new latency window or to
+        // flush a full batch; otherwise it is already sleeping until the
+        // deadline of the oldest pending scan.
+        should_notify = m_pending.size() == 1 || m_pending.size() >= m_max_batch_size;
+    }
+
+    if (should_notify)
+    {
+        m_work_available.notify_one();
+    }
+}
+
+void scan_batcher_t::flush()
+{
+    std::unique_lock lock(m_lock);
+    uint64_t target_count = m_submitted_count;
+    if (m_flushed_count + m_dropped_count >= target_count)
+    {
+        return;
+    }
+
+    m_flush_requested = true;
+    m_work_available.notify_one();
+    m_batch_flushed.wait(lock, [&] { return m_flushed_count + m_dropped_count >= target_count; });
+}
+
+void scan_batcher_t::worker()
+{
+    gaia::db::begin_session();
+
+    std::vector<scan_message_t> batch;
+    batch.reserve(m_max_batch_size);
+
+    std::unique_lock lock(m_lock);
+    while (true)
+    {
+        if (m_pending.empty())
+        {
+            if (m_stopping)
+            {
+                break;
+            }
+            m_work_available.wait(lock, [&] { return !m_pending.empty() || m_stopping; });
+            continue;
+        }
+
+        // Wait for the batch to fill up, but never past the deadline of the
+        // oldest pending scan.
+        m_work_available.wait_until(
+            lock, m_oldest_pending + m_max_latency, [&] {
+                return m_pending.size() >= m_max_batch_size || m_flush_requested || m_stopping;
+            });
+
+        size_t batch_size = std::min(m_pending.size(), m_max_batch_size);
+        batch.assign(m_pending.begin(), m_pending.begin() + batch_size);
+        m_pending.erase(m_pending.begin(), m_pending.begin() + batch_size);
+        // Any remainder keeps the current deadline: its scans arrived after
+        // m_oldest_pending, so this can only flush them early, never late.
+
+        lock.unlock();
+        bool is_flushed = m_flush_callback(batch);
+        lock.lock();
+
+        (is_flushed ? m_flushed_count : m_dropped_count) += batch_size;
+        if (m_flushed_count + m_dropped_count >= m_submitted_count)
+        {
+            m_flush_requested = false;
+        }
+        m_batch_flushed.notify_all();
+    }
+
+    lock.unlock();
+    gaia::db::end_session();
+}
@@ -0,0 +1,131 @@
+/////////////////////////////////////////////
+// Copyright (c) Gaia Platform LLC
+// All rights reserved.
+/////////////////////////////////////////////
+
+#include "scan_binary.hpp"
+
+#include <cstring>
+
+namespace scan_binary
+{
+
+constexpr size_t c_face_signature_offset = 40;
+constexpr size_t c_license_offset = 104;
+
+// Explicit byte-by-byte conversions keep the format little-endian on any
+// host and avoid unaligned loads.
+uint64_t read_uint64(const uint8_t* data)
+{
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; i--)
+    {
+        value = (value << 8) | data[i];
+    }
+    return value;
+}
+
+uint32_t read_uint32(const uint8_t* data)
+{
+    return uint32_t{data[0]} | (uint32_t{data[1]} << 8) | (uint32_t{data[2]} << 16) | (uint32_t{data[3]} << 24);
+}
+
+void write_uint64(uint64_t value, uint8_t* data)
+{
+    for (int i = 0; i < 8; i++)
+    {
+        data[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+bool decode_record(std::string_view record, scan_message_t& scan)
+{
+    if (record.size() != c_record_size)
+    {
+        return false;
+    }
+
+    auto data = reinterpret_cast<const uint8_t*>(record.data());
+    uint8_t flags = data[2];
+    if (data[0] != c_record_version
+        || data[1] > enums::scan_table::e_scan_type::leaving
+        || (flags & ~(c_has_room_id_flag | c_has_building_id_flag))
+        || data[3] > c_max_face_signature_length
+        || data[4] > c_max_license_length
+        || data[5] != 0 || data[6] != 0 || data[7] != 0)
+    {
+        return false;
+    }
+
+    scan.scan_type = static_cast<enums::scan_table::e_scan_type>(data[1]);
+    scan.has_room_id = flags & c_has_room_id_flag;
+    scan.has_building_id = flags & c_has_building_id_flag;
+    scan.person_id = read_uint64(data + 8);
+    scan.room_id = read_uint64(data + 16);
+    scan.building_id = read_uint64(data + 24);
+    scan.timestamp = read_uint64(data + 32);
+
+    scan.face_signature_length = data[3];
+    memcpy(scan.face_signature, data + c_face_signature_offset, scan.face_signature_length);
+    scan.license_length = data[4];
+    memcpy(scan.license, data + c_license_offset, scan.license_length);
+
+    return true;
+}
+
+void encode_record(const scan_message_t& scan, uint8_t* record)
+{
+    memset(record, 0, c_record_size);
+
+    record[0] = c_record_version;
+    record[1] = scan.scan_type;
+    record[2] = (scan.has_room_id ? c_has_room_id_flag : 0) | (scan.has_building_id ? c_has_building_id_flag : 0);
+    record[3] = scan.face_signature_length;
+    record[4] = scan.license_length;
+    write_uint64(scan.person_id, record + 8);
+    write_uint64(scan.room_id, record + 16);
+    write_uint64(scan.building_id, record + 24);
+    write_uint64(scan.timestamp, record + 32);
+    memcpy(record + c_face_signature_offset, scan.face_signature, scan.face_signature_length);
+    memcpy(record + c_license_offset, scan.license, scan.license_length);
+}
+
+// Returns the number of records in a batch frame, after checking that the
+// header is valid and that the frame holds exactly that many records.
+bool get_batch_record_count(std::string_view frame, uint32_t& record_count)
+{
+    if (frame.size() < c_batch_header_size)
+    {
+        return false;
+    }
+
+    auto data = reinterpret_cast<const uint8_t*>(frame.data());
+    if (data[0] != c_record_version || data[1] != 0 || data[2] != 0 || data[3] != 0)
+    {
+        return false;
+    }
+
+    record_count = read_uint32(data + 4);
+    return frame.size() == c_batch_header_size + uint64_t{record_count} * c_record_size;
+}
+
+bool decode_batch(std::string_view frame, std::vector<scan_message_t>& scans)
+{
+    uint32_t record_count;
+    if (!get_batch_record_count(frame, record_count))
+    {
+        return false;
+    }
+
+    scans.resize(record_count);
+    for (uint32_t i = 0; i < record_count; i++)
+    {
+        if (!decode_record(frame.substr(c_batch_header_size + i * c_record_size, c_record_size), scans[i]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace scan_binary
@@ -0,0 +1,307 @@
+/////////////////////////////////////////////
+// Copyright (c) Gaia Platform LLC
+// All rights reserved.
+/////////////////////////////////////////////
+
+#include "scan_parser.hpp"
+
+#include <cstring>
+
+namespace scan_parser
+{
+
+using enums::scan_table::e_scan_type;
+
+struct scan_type_name_t
+{
+    std::string_view name;
+    e_scan_type scan_type;
+};
+
+// Perfect hash over the scan type names: (length + name[1] + name[length - 2]) % 8
+// is distinct for each of them. Slot 6 is unused.
+const scan_type_name_t c_scan_type_names[8] = {
+    {"face", e_scan_type::face},
+    {"joining_wifi", e_scan_type::joining_wifi},
+    {"leaving", e_scan_type::leaving},
+    {"vehicle_entering", e_scan_type::vehicle_entering},
+    {"vehicle_departing", e_scan_type::vehicle_departing},
+    {"badge", e_scan_type::badge},
+    {"", e_scan_type::badge},
+    {"leaving_wifi", e_scan_type::leaving_wifi},
+};
+
+bool scan_type_from_string(std::string_view name, e_scan_type& scan_type)
+{
+    if (name.size() < 2)
+    {
+        return false;
+    }
+
+    size_t slot = (name.size() + static_cast<unsigned char>(name[1])
+                   + static_cast<unsigned char>(name[name.size() - 2]))
+        & 7;
+    const scan_type_name_t& candidate = c_scan_type_names[slot];
+    if (candidate.name != name)
+    {
+        return false;
+    }
+
+    scan_type = candidate.scan_type;
+    return true;
+}
+
+// A cursor over the payload. Every method returns false on malformed input.
+class reader_t
+{
+public:
+    explicit reader_t(std::string_view text)
+        : m_current(text.data()), m_end(text.data() + text.size())
+    {
+    }
+
+    void skip_whitespace()
+    {
+        while (m_current < m_end
+               && (*m_current == ' ' || *m_current == '\t' || *m_current == '\n' || *m_current == '\r'))
+        {
+            m_current++;
+        }
+    }
+
+    bool at_end()
+    {
+        skip_whitespace();
+        return m_current == m_end;
+    }
+
+    bool consume(char expected)
+    {
+        skip_whitespace();
+        if (m_current < m_end && *m_current == expected)
+        {
+            m_current++;
+            return true;
+        }
+        return false;
+    }
+
+    bool peek(char expected)
+    {
+        skip_whitespace();
+        return m_current < m_end && *m_current == expected;
+    }
+
+    // Reads a string without decoding escapes; the returned view covers the
+    // raw characters between the quotes.
+    bool read_string(std::string_view& value)
+    {
+        if (!consume('"'))
+        {
+            return false;
+        }
+
+        const char* start = m_current;
+        while (m_current < m_end && *m_current != '"')
+        {
+            if (*m_current == '\\')
+            {
+                m_current++;
+            }
+            m_current++;
+        }
+        if (m_current >= m_end)
+        {
+            return false;
+        }
+
+        value = std::string_view(start, m_current - start);
+        m_current++;
+        return true;
+    }
+
+    // Reads a string that contains no escapes, so the raw characters are
+    // its value.
+    bool read_plain_string(std::string_view& value)
+    {
+        return read_string(value) && value.find('\\') == std::string_view::npos;
+    }
+
+    bool read_unsigned(uint64_t& value)
+    {
+        skip_whitespace();
+        const char* start = m_current;
+
+        // JSON does not allow leading zeros.
+        if (m_end - m_current >= 2 && m_current[0] == '0' && m_current[1] >= '0' && m_current[1] <= '9')
+        {
+            return false;
+        }
+
+        value = 0;
+        while (m_current < m_end && *m_current >= '0' && *m_current <= '9')
+        {
+            uint64_t digit = *m_current - '0';
+            if (value > (UINT64_MAX - digit) / 10)
+            {
+                return false;
+            }
+            value = value * 10 + digit;
+            m_current++;
+        }
+
+        // Fractions and exponents are left to the general-purpose parser.
+        return m_current != start
+            && (m_current == m_end || (*m_current != '.' && *m_current != 'e' && *m_current != 'E'));
+    }
+
+    bool read_literal(const char* literal)
+    {
+        skip_whitespace();
+        size_t length = strlen(literal);
+        if (static_cast<size_t>(m_end - m_current) < length || memcmp(m_current, literal, length) != 0)
+        {
+            return false;
+        }
+        m_current += length;
+        return true;
+    }
+
+    // Skips over any JSON value, including nested objects and arrays.
+    bool skip_value()
+    {
+        skip_whitespace();
+        if (m_current >= m_end)
+        {
+            return false;
+        }
+
+        if (*m_current == '"')
+        {
+            std::string_view ignored;
+            return read_string(ignored);
+        }
+
+        if (*m_current == '{' || *m_current == '[')
+        {
+            size_t depth = 0;
+            while (m_current < m_end)
+            {
+                char character = *m_current;
+                if (character == '"')
+                {
+                    std::string_view ignored;
+                    if (!read_string(ignored))
+                    {
+                        return false;
+                    }
+                    continue;
+                }
+
+                m_current++;
+                if (character == '{' || character == '[')
+                {
+                    depth++;
+                }
+                else if (character == '}' || character == ']')
+                {
+                    if (--depth == 0)
+                    {
+                        return true;
+                    }
+                }
+            }
+            return false;
+        }
+
+        // Numbers and literals run until the next delimiter.
+        const char* start = m_current;
+        while (m_current < m_end && *m_current != ',' && *m_current != '}' && *m_current != ']'
+               && *m_current != ' ' && *m_current != '\t' && *m_current != '\n' && *m_current != '\r')
+        {
+            m_current++;
+        }
+        return m_current != start;
+    }
+
+    // Reads an optional ID: an unsigned integer or null.
+    bool read_optional_id(uint64_t& value, bool& has_value)
+    {
+        if (peek('n'))
+        {
+            has_value = false;
+            return read_literal("null");
+        }
+
+        has_value = true;
+        return read_unsigned(value);
+    }
+
+private:
+    const char* m_current;
+    const char* m_end;
+};
+
+bool parse(std::string_view payload, scan_message_t& scan)
+{
+    scan = scan_message_t{};
+    bool has_person_id = false;
+
+    reader_t reader(payload);
+    if (!reader.consume('{'))
+    {
+        return false;
+    }
+
+    if (!reader.consume('}'))
+    {
+        do
+        {
+            std::string_view key;
+            if (!reader.read_plain_string(key) || !reader.consume(':'))
+            {
+                return false;
+            }
+
+            bool is_valid;
+            if (key == "scan_type")
+            {
+                // Unknown and escaped names are left to the general-purpose
+                // parser.
+                std::string_view name;
+                is_valid = reader.read_plain_string(name) && scan_type_from_string(name, scan.scan_type);
+            }
+            else if (key == "person_id")
+            {
+                is_valid = reader.read_unsigned(scan.person_id);
+                has_person_id = true;
+            }
+            else if (key == "room_id")
+            {
+                is_valid = reader.read_optional_id(scan.room_id, scan.has_room_id);
+            }
+            else if (key == "building_id")
+            {
+                is_valid = reader.read_optional_id(scan.building_id, scan.has_building_id);
+            }
+            else
+            {
+                is_valid = reader.skip_value();
+            }
+
+            if (!is_valid)
+            {
+                return false;
+            }
+        } while (reader.consume(','));
+
+        if (!reader.consume('}'))
+        {
+            return false;
+        }
+    }
+
+    return has_person_id && reader.at_end();
+}
+
+} // namespace scan_parser
@@ -0,0 +1,463 @@
+/////////////////////////////////////////////
+// Copyright (c) Gaia Platform LLC
+// All rights reserved.
+/////////////////////////////////////////////
+
+#include "scan_retention.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#include "gaia/db/db.hpp"
+#include "gaia/logger.hpp"
+
+#include "enums.hpp"
+#include "helpers.hpp"
+#include "metrics.hpp"
+
+using namespace gaia::access_control;
+using gaia::common::gaia_id_t;
+
+namespace scan_retention
+{
+
+// Scans are deleted in transactions of this many, so that the rules'
+// transactions on the same people and rooms rarely conflict with them.
+constexpr size_t c_delete_batch_size = 1000;
+constexpr uint32_t c_max_delete_attempts = 8;
+constexpr std::chrono::microseconds c_delete_retry_backoff{100};
+
+// A committed scan still waiting for a rule this many retention periods
+// after its first report is assumed to have lost that rule for good.
+constexpr uint32_t c_abandoned_scan_periods = 4;
+
+// Expired scans are looked for at least this often.
+constexpr std::chrono::milliseconds c_max_prune_interval{1000};
+
+// The application clock counts minutes.
+constexpr uint64_t c_time_units_per_hour = 60;
+
+struct queued_scan_t
+{
+    std::chrono::steady_clock::time_point insert_time;
+    uint64_t app_time;
+    gaia_id_t scan_id;
+};
+
+struct rollup_key_t
+{
+    uint64_t building_id;
+    uint64_t hour;
+
+    bool operator==(const rollup_key_t& other) const
+    {
+        return building_id == other.building_id && hour == other.hour;
+    }
+};
+
+struct rollup_key_hash_t
+{
+    size_t operator()(const rollup_key_t& key) const
+    {
+        return std::hash<uint64_t>()(key.building_id * 0x9E3779B97F4A7C15ull ^ key.hour);
+    }
+};
+
+using rollup_counts_t = std::unordered_map<rollup_key_t, uint64_t, rollup_key_hash_t>;
+using rollup_ids_t = std::unordered_map<rollup_key_t, gaia_id_t, rollup_key_hash_t>;
+
+// A scan is queued for deletion once it is committed and every rule that
+// reacts to it is done with it. The rules run after the commit, but they
+// and add_scans() report in any order, so a waiting_scan_t collects the
+// reports until the last one arrives.
+struct waiting_scan_t
+{
+    std::chrono::steady_clock::time_point since;
+    bool is_committed = false;
+    bool has_expected_rules = false;
+    uint32_t expected_rules = 0;
+    uint32_t done_rules = 0;
+    uint64_t app_time = 0;
+
+    bool is_ready() const
+    {
+        return is_committed && has_expected_rules && (done_rules & expected_rules) == expected_rules;
+    }
+};
+
+std::mutex g_queue_lock;
+std::deque<queued_scan_t> g_queue;
+std::unordered_map<gaia_id_t, waiting_scan_t> g_waiting_scans;
+bool g_is_enabled = false;
+
+// Only touched by the pruner thread, and by start() and clear() while it is
+// not running.
+rollup_ids_t g_rollup_ids;
+std::chrono::milliseconds g_retention{0};
+bool g_is_rollup_enabled = false;
+
+std::thread g_pruner;
+std::mutex g_pruner_lock;
+std::condition_variable g_pruner_stop;
+bool g_is_pruner_stopping = false;
+
+static_assert(static_cast<size_t>(rule_profiler::rule_t::count) <= 32);
+
+uint32_t get_rule_bit(rule_profiler::rule_t rule)
+{
+    return uint32_t{1} << static_cast<uint32_t>(rule);
+}
+
+// The rules that react to the flag on_insert(scan) sets for each scan type.
+// Keep in step with access_control.ruleset.
+uint32_t get_follower_rules(enums::scan_table::e_scan_type scan_type)
+{
+    using enums::scan_table::e_scan_type;
+    using rule_profiler::rule_t;
+
+    uint32_t rules = get_rule_bit(rule_t::scan_updated);
+    switch (scan_type)
+    {
+        case e_scan_type::badge:
+            return rules | get_rule_bit(rule_t::badge_scan);
+        case e_scan_type::vehicle_entering:
+            return rules | get_rule_bit(rule_t::vehicle_entering);
+        case e_scan_type::vehicle_departing:
+            return rules | get_rule_bit(rule_t::vehicle_departing);
+        case e_scan_type::joining_wifi:
+            return rules | get_rule_bit(rule_t::joining_wifi);
+        case e_scan_type::leaving_wifi:
+            return rules | get_rule_bit(rule_t::leaving_wifi);
+        case e_scan_type::face:
+            return rules | get_rule_bit(rule_t::face_without_credentials) | get_rule_bit(rule_t::employee_face_scan)
+                | get_rule_bit(rule_t::visitor_face_scan) | get_rule_bit(rule_t::inadmissible_face_scan);
+        case e_scan_type::leaving:
+            return rules | get_rule_bit(rule_t::leaving);
+    }
+    return rules;
+}
+
+// Applies a report to the scan's waiting_scan_t and queues the scan if it
+// was the last one. Must be called with g_queue_lock held.
+template <typename F>
+void report(gaia_id_t scan_id, std::chrono::steady_clock::time_point now, F update)
+{
+    auto waiting_scan = g_waiting_scans.try_emplace(scan_id).first;
+    if (waiting_scan->second.since == std::chrono::steady_clock::time_point{})
+    {
+        waiting_scan->second.since = now;
+    }
+
+    update(waiting_scan->second);
+    if (waiting_scan->second.is_ready())
+    {
+        g_queue.push_back({now, waiting_scan->second.app_time, scan_id});
+        g_waiting_scans.erase(waiting_scan);
+    }
+}
+
+void add_scans(const std::vector<gaia_id_t>& scan_ids)
+{
+    auto now = std::chrono::steady_clock::now();
+    uint64_t app_time = helpers::get_time_now();
+
+    std::lock_guard lock(g_queue_lock);
+    if (!g_is_enabled)
+    {
+        return;
+    }
+    for (gaia_id_t scan_id : scan_ids)
+    {
+        report(scan_id, now, [app_time](waiting_scan_t& waiting_scan) {
+            waiting_scan.is_committed = true;
+            waiting_scan.app_time = app_time;
+        });
+    }
+}
+
+// Records the rules that will report on the scan.
+void set_expected_rules(gaia_id_t scan_id, uint32_t rules)
+{
+    auto now = std::chrono::steady_clock::now();
+
+    std::lock_guard lock(g_queue_lock);
+    if (!g_is_enabled)
+    {
+        return;
+    }
+    report(scan_id, now, [rules](waiting_scan_t& waiting_scan) {
+        waiting_scan.has_expected_rules = true;
+        waiting_scan.expected_rules = rules;
+    });
+}
+
+void expect_rules(gaia_id_t scan_id, enums::scan_table::e_scan_type scan_type)
+{
+    set_expected_rules(scan_id, get_follower_rules(scan_type));
+}
+
+void expect_no_rules(gaia_id_t scan_id)
+{
+    set_expected_rules(scan_id, 0);
+}
+
+void mark_handled(gaia_id_t scan_id, rule_profiler::rule_t rule)
+{
+    auto now = std::chrono::steady_clock::now();
+
+    std::lock_guard lock(g_queue_lock);
+    if (!g_is_enabled)
+    {
+        return;
+    }
+    report(scan_id, now, [rule](waiting_scan_t& waiting_scan) {
+        waiting_scan.done_rules |= get_rule_bit(rule);
+    });
+}
+
+// Forgets scans that were reported by rules but never as committed, such as
+// those of a rule that ran again after a conflict once the scan had already
+// been queued. Committed scans that have waited for c_abandoned_scan_periods
+// retention periods are queued for deletion as if every rule had reported.
+void expire_waiting_scans(std::chrono::steady_clock::time_point now)
+{
+    auto stale_time = now - g_retention;
+    auto abandoned_time = now - g_retention * c_abandoned_scan_periods;
+    size_t abandoned_count = 0;
+    {
+        std::lock_guard lock(g_queue_lock);
+        for (auto waiting_scan = g_waiting_scans.begin(); waiting_scan != g_waiting_scans.end();)
+        {
+            if (!waiting_scan->second.is_committed && waiting_scan->second.since <= stale_time)
+            {
+                waiting_scan = g_waiting_scans.erase(waiting_scan);
+            }
+            else if (waiting_scan->second.is_committed && waiting_scan->second.since <= abandoned_time)
+            {
+                g_queue.push_back({now, waiting_scan->second.app_time, waiting_scan->first});
+                waiting_scan = g_waiting_scans.erase(waiting_scan);
+                abandoned_count++;
+            }
+            else
+            {
+                waiting_scan++;
+            }
+        }
+    }
+
+    if (abandoned_count > 0)
+    {
+        gaia_log::app().warn(
+            "Queued {} scans whose rules did not all report within {} retention periods.", abandoned_count,
+            c_abandoned_scan_periods);
+    }
+}
+
+// Must be called inside a transaction.
+void delete_scan(scan_t scan)
+{
+    if (scan.seen_who_person())
+    {
+        scan.seen_who_person().scans().remove(scan);
+    }
+    if (scan.seen_in_room())
+    {
+        scan.seen_in_room().scans().remove(scan);
+    }
+    if (scan.seen_at_building())
+    {
+        scan.seen_at_building().scans().remove(scan);
+    }
+    if (scan.seen_license_vehicle())
+    {
+        scan.seen_license_vehicle().scans().remove(scan);
+    }
+    scan.delete_row();
+}
+
+// Must be called inside a transaction. Rollup rows created here are
+// returned in new_rollup_ids, to be indexed once the transaction commits.
+void add_to_rollups(const rollup_counts_t& counts, rollup_ids_t& new_rollup_ids)
+{
+    for (const auto& [key, count] : counts)
+    {
+        auto rollup_id = g_rollup_ids.find(key);
+        if (rollup_id == g_rollup_ids.end())
+        {
+            new_rollup_ids[key] = scan_rollup_t::insert_row(key.building_id, key.hour, count);
+            continue;
+        }
+
+        auto rollup = scan_rollup_t::get(rollup_id->second);
+        auto rollup_w = rollup.writer();
+        rollup_w.scan_count = rollup.scan_count() + count;
+        rollup_w.update_row();
+    }
+}
+
+// Deletes one batch of queued scans in a transaction of its own. Returns
+// false if it could not be committed.
+bool delete_batch(const std::vector<queued_scan_t>& batch)
+{
+    for (uint32_t attempt = 1;; attempt++)
+    {
+        rollup_counts_t counts;
+        rollup_ids_t new_rollup_ids;
+        try
+        {
+            gaia::db::begin_transaction();
+            for (const queued_scan_t& queued_scan : batch)
+            {
+                auto scan = scan_t::get(queued_scan.scan_id);
+                if (!scan)
+                {
+                    continue;
+                }
+                if (g_is_rollup_enabled && scan.seen_at_building())
+                {
+                    counts[{scan.seen_at_building().building_id(), queued_scan.app_time / c_time_units_per_hour}]++;
+                }
+                delete_scan(scan);
+            }
+            add_to_rollups(counts, new_rollup_ids);
+            gaia::db::commit_transaction();
+
+            g_rollup_ids.insert(new_rollup_ids.begin(), new_rollup_ids.end());
+            return true;
+        }
+        catch (const gaia::db::transaction_update_conflict&)
+        {
+            if (attempt == c_max_delete_attempts)
+            {
+                gaia_log::app().error(
+                    "Could not delete {} expired scans after {} conflicting attempts.", batch.size(), attempt);
+                return false;
+            }
+            std::this_thread::sleep_for(c_delete_retry_backoff * attempt);
+        }
+        catch (const std::exception& e)
+        {
+            if (gaia::db::is_transaction_open())
+            {
+                gaia::db::rollback_transaction();
+            }
+            gaia_log::app().error("Could not delete {} expired scans: {}", batch.size(), e.what());
+            return false;
+        }
+    }
+}
+
+// Deletes every queued scan handled longer ago than the retention period.
+// Scans that could not be deleted stay queued for the next round.
+void prune()
+{
+    auto now = std::chrono::steady_clock::now();
+    auto expiry_time = now - g_retention;
+    std::vector<queued_scan_t> batch;
+
+    expire_waiting_scans(now);
+
+    while (true)
+    {
+        batch.clear();
+        {
+            std::lock_guard lock(g_queue_lock);
+            for (size_t i = 0; i < g_queue.size() && batch.size() < c_delete_batch_size; i++)
+            {
+                if (g_queue[i].insert_time > expiry_time)
+                {
+                    break;
+                }
+                batch.push_back(g_queue[i]);
+            }
+        }
+
+        if (batch.empty() || !delete_batch(batch))
+        {
+            return;
+        }
+
+        // Only this thread removes scans, so the batch is still at the front.
+        {
+            std::lock_guard lock(g_queue_lock);
+            g_queue.erase(g_queue.begin(), g_queue.begin() + batch.size());
+        }
+        metrics::count(metrics::counter_t::scans_expired, batch.size());
+    }
+}
+
+void start(std::chrono::milliseconds retention, bool is_rollup_enabled)
+{
+    g_retention = retention;
+    g_is_rollup_enabled = is_rollup_enabled;
+
+    auto now = std::chrono::steady_clock::now();
+    uint64_t app_time = helpers::get_time_now();
+    {
+        std::lock_guard lock(g_queue_lock);
+        g_is_enabled = true;
+
+        // Scans kept across a restart expire one retention period from now.
+        gaia::db::begin_transaction();
+        for (const auto& scan : scan_t::list())
+        {
+            g_queue.push_back({now, app_time, scan.gaia_id()});
+        }
+        g_rollup_ids.clear();
+        for (const auto& rollup : scan_rollup_t::list())
+        {
+            g_rollup_ids[{rollup.building_id(), rollup.hour()}] = rollup.gaia_id();
+        }
+        gaia::db::commit_transaction();
+    }
+
+    g_is_pruner_stopping = false;
+    g_pruner = std::thread([] {
+        gaia::db::begin_session();
+
+        std::unique_lock lock(g_pruner_lock);
+        auto interval = std::min(g_retention, c_max_prune_interval);
+        while (!g_pruner_stop.wait_for(lock, interval, [] { return g_is_pruner_stopping; }))
+        {
+            lock.unlock();
+            prune();
+            lock.lock();
+        }
+
+        lock.unlock();
+        gaia::db::end_session();
+    });
+}
+
+void stop()
+{
+    {
+        std::lock_guard lock(g_pruner_lock);
+        g_is_pruner_stopping = true;
+    }
+    g_pruner_stop.notify_one();
+
+    if (g_pruner.joinable())
+    {
+        g_pruner.join();
+    }
+
+    // The scans still in the table are queued again on the next start.
+    std::lock_guard lock(g_queue_lock);
+    g_is_enabled = false;
+    g_queue.clear();
+    g_waiting_scans.clear();
+}
+
+void clear()
+{
+    std::lock_guard lock(g_queue_lock);
+    g_queue.clear();
+    g_waiting_scans.clear();
+    g_rollup_ids.clear();
+}
+
+} // namespace scan_retention
@@ -0,0 +1,259 @@
+/////////////////////////////////////////////
+// Copyright (c) Gaia Platform LLC
+// All rights reserved.
+/////////////////////////////////////////////
+
+#include "site_import.hpp"
+
+#include <fstream>
+#include <optional>
+#include <unordered_map>
+
+#include "gaia/db/db.hpp"
+#include "gaia/logger.hpp"
+
+#include "app.hpp"
+#include "helpers.hpp"
+#include "json.hpp"
+
+using json = nlohmann::json;
+using namespace gaia::access_control;
+using gaia::common::gaia_id_t;
+
+namespace site_import
+{
+
+// Events have no numeric external ID, so the file's event IDs are resolved
+// through a map of their own, kept for the duration of the import.
+using event_map_t = std::unordered_map<std::string, gaia_id_t>;
+
+// Each import_* function reads every field before writing anything, so that
+// a row with a mistyped field is skipped as a whole. They return false for
+// rows that refer to unknown IDs or repeat an ID already imported.
+
+// Reads an optional unsigned field; throws if it has the wrong type.
+std::optional<uint64_t> get_optional_uint(const json& row, const char* key)
+{
+    auto value = row.find(key);
+    if (value == row.end())
+    {
+        return std::nullopt;
+    }
+    return value->get<uint64_t>();
+}
+
+bool import_building(const json& row)
+{
+    uint64_t building_id = row.at("building_id");
+    std::string name = row.value("name", "");
+
+    building_t existing_building;
+    if (get_building(building_id, existing_building))
+    {
+        return false;
+    }
+
+    add_building(building_id, name);
+    return true;
+}
+
+bool import_room(const json& row)
+{
+    uint64_t room_id = row.at("room_id");
+    std::string name = row.value("name", "");
+    uint32_t capacity = row.value("capacity", 0);
+    uint64_t building_id = row.at("building_id");
+
+    building_t building;
+    room_t existing_room;
+    if (!get_building(building_id, building) || get_room(room_id, existing_room))
+    {
+        return false;
+    }
+
+    add_room(room_id, name, capacity, building);
+    return true;
+}
+
+bool import_person(const json& row)
+{
+    uint64_t person_id = row.at("person_id");
+    std::string first_name = row.value("first_name", "");
+    bool employee = row.value("employee", false);
+    bool visitor = row.value("visitor", false);
+    bool stranger = row.value("stranger", false);
+
+    std::string last_name = row.value("last_name", "");
+    std::string badge_number = row.value("badge_number", "");
+    std::string face_signature = row.value("face_signature", "");
+    bool credentialed = row.value("credentialed", false);
+    bool admissible = row.value("admissible", false);
+    std::optional<uint64_t> entry_time = get_optional_uint(row, "entry_time");
+    std::optional<uint64_t> leave_time = get_optional_uint(row, "leave_time");
+
+    person_t existing_person;
+    if (get_person(person_id, existing_person))
+    {
+        return false;
+    }
+
+    // The row is complete before it is inserted, so that the rules see a
+    // single insert and the admission window is scheduled once.
+    auto person_w = person_writer();
+    person_w.person_id = person_id;
+    person_w.first_name = first_name;
+    person_w.last_name = last_name;
+    person_w.employee = employee;
+    person_w.visitor = visitor;
+    person_w.stranger = stranger;
+    person_w.badge_number = badge_number;
+    person_w.face_signature = face_signature;
+    person_w.credentialed = credentialed;
+    person_w.admissible = admissible;
+    person_w.entry_time = entry_time.value_or(c_default_entry_time);
+    person_w.leave_time = leave_time.value_or(c_default_leave_time);
+    insert_person(person_w);
+    return true;
+}
+
+bool import_event(const json& row, event_map_t& events)
+{
+    std::string event_id = row.at("event_id");
+    std::string name = row.value("name", "");
+    uint64_t start_timestamp = row.at("start_timestamp");
+    uint64_t end_timestamp = row.at("end_timestamp");
+    uint64_t room_id = row.at("room_id");
+
+    room_t room;
+    if (!get_room(room_id, room) || events.count(event_id) > 0)
+    {
+        return false;
+    }
+
+    events[event_id] = add_event(name, start_timestamp, end_timestamp, room).gaia_id();
+    return true;
+}
+
+bool import_registration(const json& row, const event_map_t& events)
+{
+    uint64_t person_id = row.at("person_id");
+    std::string event_id = row.at("event_id");
+
+    person_t person;
+    auto event = events.find(event_id);
+    if (!get_person(person_id, person) || event == events.end())
+    {
+        return false;
+    }
+
+    add_registration(person, event_t::get(event->second));
+    return true;
+}
+
+bool import_permission(const json& row)
+{
+    uint64_t person_id = row.at("person_id");
+    uint64_t room_id = row.at("room_id");
+
+    person_t person;
+    room_t room;
+    if (!get_person(person_id, person) || !get_room(room_id, room))
+    {
+        return false;
+    }
+
+    helpers::allow_person_into_room(person.gaia_id(), room);
+    return true;
+}
+
+bool import_row(const json& row, event_map_t& events)
+{
+    std::string table = row.at("table");
+    if (table == "building")
+    {
+        return import_building(row);
+    }
+    if (table == "room")
+    {
+        return import_room(row);
+    }
+    if (table == "person")
+    {
+        return import_person(row);
+    }
+    if (table == "event")
+    {
+        return import_event(row, events);
+    }
+    if (table == "registration")
+    {
+        return import_registration(row, events);
+    }
+    if (table == "permission")
+    {
+        return import_permission(row);
+    }
+    return false;
+}
+
+bool import_file(const std::string& path, uint64_t batch_size, import_stats_t& stats)
+{
+    stats = {};
+
+    std::ifstream file(path);
+    if (!file)
+    {
+        gaia_log::app().error("Could not open import file '{}'.", path);
+        return false;
+    }
+
+    event_map_t events;
+    uint64_t rows_in_transaction = 0;
+    uint64_t line_number = 0;
+    std::string line;
+
+    gaia::db::begin_transaction();
+    while (std::getline(file, line))
+    {
+        line_number++;
+        if (line.find_first_not_of(" \t\r") == std::string::npos)
+        {
+            continue;
+        }
+
+        bool is_imported = false;
+        try
+        {
+            json row = json::parse(line);
+            is_imported = import_row(row, events);
+        }
+        catch (const json::exception& e)
+        {
+            gaia_log::app().warn("{}:{}: {}", path, line_number, e.what());
+            stats.skipped_row_count++;
+            continue;
+        }
+
+        if (!is_imported)
+        {
+            gaia_log::app().warn("{}:{}: unknown table or reference, or duplicate ID; row skipped.", path, line_number);
+            stats.skipped_row_count++;
+            continue;
+        }
+
+        stats.row_count++;
+        if (++rows_in_transaction == batch_size)
+        {
+            gaia::db::commit_transaction();
+            stats.transaction_count++;
+            rows_in_transaction = 0;
+            gaia::db::begin_transaction();
+        }
+    }
+    gaia::db::commit_transaction();
+    stats.transaction_count++;
+
+    return true;
+}
+
+} // namespace site_import
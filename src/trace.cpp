@@ -0,0 +1,263 @@
+/////////////////////////////////////////////
+// Copyright (c) Gaia Platform LLC
+// All rights reserved.
+/////////////////////////////////////////////
+
+#include "trace.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <unistd.h>
+
+#include "gaia/logger.hpp"
+
+namespace trace
+{
+
+const char c_magic[] = "ACTRACE1";
+constexpr size_t c_magic_length = sizeof(c_magic) - 1;
+constexpr size_t c_record_header_length = sizeof(uint64_t) + sizeof(uint16_t) + sizeof(uint32_t);
+constexpr size_t c_write_buffer_size = 1 << 20;
+
+// Buffered records reach the file at least this often, so that a crash
+// loses at most this much of the trace.
+constexpr std::chrono::seconds c_flush_interval{1};
+
+std::mutex g_recording_lock;
+FILE* g_recording_file = nullptr;
+std::chrono::steady_clock::time_point g_recording_start;
+std::chrono::steady_clock::time_point g_last_flush;
+
+template <typename T>
+void put_le(uint8_t* buffer, T value)
+{
+    for (size_t i = 0; i < sizeof(T); i++)
+    {
+        buffer[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+template <typename T>
+T get_le(const uint8_t* buffer)
+{
+    T value = 0;
+    for (size_t i = 0; i < sizeof(T); i++)
+    {
+        value |= static_cast<T>(buffer[i]) << (8 * i);
+    }
+    return value;
+}
+
+bool parse_replay_mode(const std::string& name, replay_mode_t& mode)
+{
+    if (name == "asap")
+    {
+        mode = replay_mode_t::asap;
+    }
+    else if (name == "realtime")
+    {
+        mode = replay_mode_t::realtime;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+// Reads the records of an existing trace. Sets length to the end of its
+// last complete record and last_arrival_ns to that record's arrival time.
+// Returns false if the file is not a trace.
+bool scan_existing_trace(FILE* file, long& length, uint64_t& last_arrival_ns)
+{
+    length = 0;
+    last_arrival_ns = 0;
+
+    fseek(file, 0, SEEK_END);
+    long file_size = ftell(file);
+    rewind(file);
+
+    char magic[c_magic_length];
+    size_t magic_length = fread(magic, 1, c_magic_length, file);
+    if (magic_length == 0)
+    {
+        return true;
+    }
+    if (magic_length != c_magic_length || memcmp(magic, c_magic, c_magic_length) != 0)
+    {
+        return false;
+    }
+    length = c_magic_length;
+
+    uint8_t header[c_record_header_length];
+    while (fread(header, 1, sizeof(header), file) == sizeof(header))
+    {
+        long record_length = c_record_header_length + get_le<uint16_t>(header + sizeof(uint64_t))
+            + get_le<uint32_t>(header + sizeof(uint64_t) + sizeof(uint16_t));
+        if (length + record_length > file_size)
+        {
+            break;
+        }
+        fseek(file, length + record_length, SEEK_SET);
+        length += record_length;
+        last_arrival_ns = get_le<uint64_t>(header);
+    }
+    return true;
+}
+
+bool start_recording(const std::string& path)
+{
+    std::lock_guard lock(g_recording_lock);
+
+    // Appending continues the clock of the existing records, and drops a
+    // record that a crash cut short, so that the trace stays readable.
+    long length = 0;
+    uint64_t last_arrival_ns = 0;
+    FILE* existing_file = fopen(path.c_str(), "rb");
+    if (existing_file)
+    {
+        bool is_trace = scan_existing_trace(existing_file, length, last_arrival_ns);
+        fclose(existing_file);
+        if (!is_trace)
+        {
+            gaia_log::app().error("'{}' exists and is not a trace file.", path);
+            return false;
+        }
+        if (truncate(path.c_str(), length) != 0)
+        {
+            gaia_log::app().error("Could not drop the partial record at the end of trace file '{}'.", path);
+            return false;
+        }
+    }
+
+    FILE* file = fopen(path.c_str(), "ab");
+    if (!file)
+    {
+        gaia_log::app().error("Could not open trace file '{}' for writing.", path);
+        return false;
+    }
+    setvbuf(file, nullptr, _IOFBF, c_write_buffer_size);
+    if (length == 0)
+    {
+        fwrite(c_magic, 1, c_magic_length, file);
+    }
+
+    g_recording_file = file;
+    g_recording_start = std::chrono::steady_clock::now() - std::chrono::nanoseconds(last_arrival_ns);
+    g_last_flush = std::chrono::steady_clock::now();
+    gaia_log::app().info("Recording received messages to '{}'.", path);
+    return true;
+}
+
+void record(const std::string& topic, const std::string& payload)
+{
+    auto arrival = std::chrono::steady_clock::now();
+
+    std::lock_guard lock(g_recording_lock);
+    if (!g_recording_file)
+    {
+        return;
+    }
+
+    if (topic.size() > std::numeric_limits<uint16_t>::max()
+        || payload.size() > std::numeric_limits<uint32_t>::max())
+    {
+        gaia_log::app().warn("Message on topic {} is too large to record.", topic);
+        return;
+    }
+
+    uint8_t header[c_record_header_length];
+    put_le<uint64_t>(header, std::chrono::duration_cast<std::chrono::nanoseconds>(arrival - g_recording_start).count());
+    put_le<uint16_t>(header + sizeof(uint64_t), topic.size());
+    put_le<uint32_t>(header + sizeof(uint64_t) + sizeof(uint16_t), payload.size());
+
+    fwrite(header, 1, sizeof(header), g_recording_file);
+    fwrite(topic.data(), 1, topic.size(), g_recording_file);
+    fwrite(payload.data(), 1, payload.size(), g_recording_file);
+
+    if (arrival - g_last_flush >= c_flush_interval)
+    {
+        fflush(g_recording_file);
+        g_last_flush = arrival;
+    }
+}
+
+void stop_recording()
+{
+    std::lock_guard lock(g_recording_lock);
+    if (g_recording_file)
+    {
+        fclose(g_recording_file);
+        g_recording_file = nullptr;
+    }
+}
+
+bool replay(
+    const std::string& path, replay_mode_t mode,
+    gaia::access_control::communication::message_callback_t callback, replay_stats_t& stats)
+{
+    stats = {};
+
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file)
+    {
+        gaia_log::app().error("Could not open trace file '{}'.", path);
+        return false;
+    }
+
+    char magic[c_magic_length];
+    if (fread(magic, 1, c_magic_length, file) != c_magic_length || memcmp(magic, c_magic, c_magic_length) != 0)
+    {
+        gaia_log::app().error("'{}' is not a trace file.", path);
+        fclose(file);
+        return false;
+    }
+
+    // Reused for every record, so replay does not allocate once they have
+    // grown to the largest message.
+    std::string topic;
+    std::string payload;
+
+    auto replay_start = std::chrono::steady_clock::now();
+    uint8_t header[c_record_header_length];
+    while (true)
+    {
+        size_t header_length = fread(header, 1, sizeof(header), file);
+        if (header_length != sizeof(header))
+        {
+            stats.is_truncated = header_length != 0;
+            break;
+        }
+
+        uint64_t arrival_ns = get_le<uint64_t>(header);
+        topic.resize(get_le<uint16_t>(header + sizeof(uint64_t)));
+        payload.resize(get_le<uint32_t>(header + sizeof(uint64_t) + sizeof(uint16_t)));
+
+        if (fread(topic.data(), 1, topic.size(), file) != topic.size()
+            || fread(payload.data(), 1, payload.size(), file) != payload.size())
+        {
+            stats.is_truncated = true;
+            break;
+        }
+
+        if (mode == replay_mode_t::realtime)
+        {
+            std::this_thread::sleep_until(replay_start + std::chrono::nanoseconds(arrival_ns));
+        }
+
+        callback(topic, payload);
+
+        stats.message_count++;
+        stats.payload_bytes += payload.size();
+        stats.trace_duration_ns = arrival_ns;
+    }
+
+    fclose(file);
+    return true;
+}
+
+} // namespace trace
@@ -0,0 +1,658 @@
+/////////////////////////////////////////////
+// Copyright (c) Gaia Platform LLC
+// All rights reserved.
+/////////////////////////////////////////////
+
+#include "ui.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "communication.hpp"
+#include "json_writer.hpp"
+
+#include "gaia/db/db.hpp"
+#include "gaia/logger.hpp"
+
+using namespace gaia::access_control;
+
+namespace ui
+{
+
+const std::string c_snapshot_topic = "access_control_json";
+const std::string c_delta_topic = "access_control_delta";
+
+std::atomic<uint64_t> g_sequence_number{0};
+
+// Fragment cache.
+//
+// Person and event fragments are serialized once and reused until the row
+// they were built from is invalidated. Every fragment carries the version
+// of its row, taken before it was built; invalidating a row gives it a new
+// version, so a fragment that was being built concurrently with the
+// invalidation is never stored. Versions come from one counter per cache,
+// and a row keeps its version in its cached entry, or in m_versions while
+// it is invalidated and not rebuilt yet, so the cache never holds more
+// than one version per row. Person and event fragments also embed room and
+// event names; changes to those rows bump a shared epoch that invalidates
+// every cached fragment at once.
+class fragment_cache_t
+{
+public:
+    // Appends the cached fragment to the writer, if there is a valid one.
+    bool append_to(gaia::common::gaia_id_t id, uint64_t epoch, json_writer_t& writer)
+    {
+        std::lock_guard lock(m_lock);
+        auto iter = m_entries.find(id);
+        if (iter == m_entries.end() || iter->second.epoch != epoch)
+        {
+            return false;
+        }
+
+        writer.raw(iter->second.fragment);
+        return true;
+    }
+
+    // Returns the version that a fragment built from now on must carry.
+    uint64_t get_version(gaia::common::gaia_id_t id)
+    {
+        std::lock_guard lock(m_lock);
+        return get_current_version(id);
+    }
+
+    void store(gaia::common::gaia_id_t id, uint64_t version, uint64_t epoch, const std::string& fragment)
+    {
+        std::lock_guard lock(m_lock);
+        if (get_current_version(id) == version)
+        {
+            m_versions.erase(id);
+            entry_t& entry = m_entries[id];
+            entry.version = version;
+            entry.epoch = epoch;
+            entry.fragment = fragment;
+        }
+    }
+
+    void invalidate(gaia::common::gaia_id_t id)
+    {
+        std::lock_guard lock(m_lock);
+        m_versions[id] = ++m_last_version;
+        m_entries.erase(id);
+    }
+
+    void clear()
+    {
+        std::lock_guard lock(m_lock);
+        m_clear_version = ++m_last_version;
+        m_versions.clear();
+        m_entries.clear();
+    }
+
+private:
+    struct entry_t
+    {
+        uint64_t version;
+        uint64_t epoch;
+        std::string fragment;
+    };
+
+    uint64_t get_current_version(gaia::common::gaia_id_t id) const
+    {
+        auto entry = m_entries.find(id);
+        if (entry != m_entries.end())
+        {
+            return entry->second.version;
+        }
+        auto version = m_versions.find(id);
+        return version == m_versions.end() ? m_clear_version : version->second;
+    }
+
+    std::mutex m_lock;
+    uint64_t m_last_version = 0;
+    // The version of rows that were neither invalidated nor built since
+    // the last clear().
+    uint64_t m_clear_version = 0;
+    std::unordered_map<gaia::common::gaia_id_t, uint64_t> m_versions;
+    std::unordered_map<gaia::common::gaia_id_t, entry_t> m_entries;
+};
+
+fragment_cache_t g_person_fragments;
+fragment_cache_t g_event_fragments;
+std::atomic<uint64_t> g_shared_row_epoch{0};
+
+// Messages are streamed straight from the EDC iterators into reusable
+// per-thread buffers. Object keys are written in sorted order so that the
+// output matches what the GUI received when the messages were built with
+// nlohmann::json.
+thread_local json_writer_t t_message_writer;
+thread_local json_writer_t t_person_writer;
+thread_local json_writer_t t_event_writer;
+
+void write_event(json_writer_t& writer, event_t event)
+{
+    uint64_t epoch = g_shared_row_epoch;
+    if (g_event_fragments.append_to(event.gaia_id(), epoch, writer))
+    {
+        return;
+    }
+
+    uint64_t version = g_event_fragments.get_version(event.gaia_id());
+
+    json_writer_t& fragment = t_event_writer;
+    fragment.clear();
+    fragment.begin_object();
+    fragment.key("end_timestamp");
+    fragment.value(event.end_timestamp());
+    fragment.key("name");
+    fragment.value(event.name());
+    fragment.key("room_name");
+    fragment.value(event.held_in_room().name());
+    fragment.key("start_timestamp");
+    fragment.value(event.start_timestamp());
+    fragment.end_object();
+
+    g_event_fragments.store(event.gaia_id(), version, epoch, fragment.str());
+    writer.raw(fragment.str());
+}
+
+void write_person(json_writer_t& writer, person_t person)
+{
+    uint64_t epoch = g_shared_row_epoch;
+    if (g_person_fragments.append_to(person.gaia_id(), epoch, writer))
+    {
+        return;
+    }
+
+    uint64_t version = g_person_fragments.get_version(person.gaia_id());
+
+    json_writer_t& fragment = t_person_writer;
+    fragment.clear();
+    fragment.begin_object();
+    fragment.key("admissible");
+    fragment.value(person.admissible());
+    fragment.key("badged");
+    fragment.value(person.badged());
+    fragment.key("credentialed");
+    fragment.value(person.credentialed());
+    fragment.key("employee");
+    fragment.value(person.employee());
+
+    fragment.key("events");
+    fragment.begin_array();
+    for (auto reg_iter = person.registrations().begin();
+         reg_iter != person.registrations().end();
+         reg_iter++)
+    {
+        write_event(fragment, reg_iter->occasion());
+    }
+    fragment.end_array();
+
+    fragment.key("first_name");
+    fragment.value(person.first_name());
+
+    if (person.inside_room())
+    {
+        fragment.key("inside_room");
+        fragment.value(person.inside_room().name());
+    }
+
+    fragment.key("on_wifi");
+    fragment.value(person.on_wifi());
+    fragment.key("parked");
+    fragment.value(person.parked());
+    fragment.key("person_id");
+    fragment.value(person.person_id());
+    fragment.key("stranger");
+    fragment.value(person.stranger());
+    fragment.key("visitor");
+    fragment.value(person.visitor());
+    fragment.end_object();
+
+    g_person_fragments.store(person.gaia_id(), version, epoch, fragment.str());
+    writer.raw(fragment.str());
+}
+
+// Room fragments in deltas also carry the ID of their building.
+void write_room(json_writer_t& writer, room_t room, bool with_building_id = false)
+{
+    writer.begin_object();
+    if (with_building_id)
+    {
+        writer.key("building_id");
+        writer.value(room.building().building_id());
+    }
+    writer.key("capacity");
+    writer.value(uint64_t{room.capacity()});
+
+    writer.key("events");
+    writer.begin_array();
+    for (auto event_iter = room.events().begin();
+         event_iter != room.events().end();
+         event_iter++)
+    {
+        write_event(writer, *event_iter);
+    }
+    writer.end_array();
+
+    writer.key("name");
+    writer.value(room.name());
+
+    writer.key("people");
+    writer.begin_array();
+    for (auto person_iter = room.people_inside().begin();
+         person_iter != room.people_inside().end();
+         person_iter++)
+    {
+        write_person(writer, *person_iter);
+    }
+    writer.end_array();
+
+    writer.key("room_id");
+    writer.value(room.room_id());
+    writer.end_object();
+}
+
+// Building fragments in deltas omit the rooms; those are sent as separate
+// fragments when they change.
+void write_building(json_writer_t& writer, building_t building, bool with_rooms = true)
+{
+    writer.begin_object();
+    writer.key("building_id");
+    writer.value(building.building_id());
+    writer.key("name");
+    writer.value(building.name());
+
+    writer.key("people");
+    writer.begin_array();
+    for (auto person_iter = building.people_entered().begin();
+         person_iter != building.people_entered().end();
+         person_iter++)
+    {
+        if (!person_iter->inside_room()) {
+            write_person(writer, *person_iter);
+        }
+    }
+    writer.end_array();
+
+    if (with_rooms)
+    {
+        writer.key("rooms");
+        writer.begin_array();
+        for (auto room_iter = building.rooms().begin();
+             room_iter != building.rooms().end();
+             room_iter++)
+        {
+            write_room(writer, *room_iter);
+        }
+        writer.end_array();
+    }
+    writer.end_object();
+}
+
+std::string get_init_message()
+{
+    json_writer_t& writer = t_message_writer;
+    writer.clear();
+    writer.begin_object();
+
+    writer.key("buildings");
+    writer.begin_array();
+    for (const auto& building : building_t::list())
+    {
+        write_building(writer, building);
+    }
+    writer.end_array();
+
+    writer.key("people");
+    writer.begin_array();
+    for (const auto& person : person_t::list())
+    {
+        write_person(writer, person);
+    }
+    writer.end_array();
+
+    writer.end_object();
+    return writer.str();
+}
+
+// Init message cache. Like deltas, a rebuild waits for marked rows to
+// settle, so that it does not read them before their transaction commits.
+std::mutex g_init_message_lock;
+std::shared_ptr<const std::string> g_init_message;
+bool g_is_publisher_running = false;
+
+std::shared_ptr<const std::string> build_init_message()
+{
+    gaia::db::begin_transaction();
+    auto init_message = std::make_shared<const std::string>(get_init_message());
+    gaia::db::commit_transaction();
+    return init_message;
+}
+
+std::shared_ptr<const std::string> get_cached_init_message()
+{
+    std::lock_guard lock(g_init_message_lock);
+    if (!g_init_message || !g_is_publisher_running)
+    {
+        g_init_message = build_init_message();
+    }
+    return g_init_message;
+}
+
+void refresh_init_message()
+{
+    auto init_message = build_init_message();
+
+    std::lock_guard lock(g_init_message_lock);
+    g_init_message = std::move(init_message);
+}
+
+// Must be called inside a transaction.
+void publish_full_snapshot()
+{
+    json_writer_t& writer = t_message_writer;
+    writer.clear();
+    writer.begin_object();
+
+    writer.key("buildings");
+    writer.begin_array();
+    for (auto building_iter = building_t::list().begin();
+         building_iter != building_t::list().end();
+         building_iter++)
+    {
+        write_building(writer, *building_iter);
+    }
+    writer.end_array();
+
+    writer.key("people");
+    writer.begin_array();
+    for (auto person_iter = person_t::list().begin();
+         person_iter != person_t::list().end();
+         person_iter++)
+    {
+        if (!person_iter->inside_room() && !person_iter->entered_building())
+        {
+            write_person(writer, *person_iter);
+        }
+    }
+    writer.end_array();
+
+    writer.key("seq");
+    writer.value(uint64_t{++g_sequence_number});
+    writer.end_object();
+
+    communication::publish_message(c_snapshot_topic, writer.str());
+}
+
+void update_ui()
+{
+    gaia::db::begin_transaction();
+    publish_full_snapshot();
+    gaia::db::commit_transaction();
+}
+
+// Change tracking.
+//
+// Rows are marked from inside rule transactions, before those transactions
+// commit. To avoid publishing a fragment read before the change became
+// visible, a marked row first spends one publisher interval "settling" and
+// is only published on the following tick. This is best-effort: a rule
+// transaction that takes longer than an interval to commit, or that is
+// retried, is published with its old state. The publisher therefore also
+// sends a full snapshot every snapshot interval, which repairs any such
+// delta.
+
+struct changed_rows_t
+{
+    std::unordered_set<gaia::common::gaia_id_t> persons;
+    std::unordered_set<gaia::common::gaia_id_t> rooms;
+    std::unordered_set<gaia::common::gaia_id_t> buildings;
+
+    bool empty() const
+    {
+        return persons.empty() && rooms.empty() && buildings.empty();
+    }
+
+    void clear()
+    {
+        persons.clear();
+        rooms.clear();
+        buildings.clear();
+    }
+};
+
+std::mutex g_changes_lock;
+changed_rows_t g_marked_rows;
+changed_rows_t g_settling_rows;
+bool g_full_snapshot_requested = false;
+
+// Whether the init message was invalidated in the current and the previous
+// publisher interval.
+bool g_is_init_marked = false;
+bool g_is_init_settling = false;
+
+void mark_person_changed(gaia::common::gaia_id_t person_id)
+{
+    g_person_fragments.invalidate(person_id);
+
+    std::lock_guard lock(g_changes_lock);
+    g_marked_rows.persons.insert(person_id);
+    g_is_init_marked = true;
+}
+
+void mark_room_changed(gaia::common::gaia_id_t room_id)
+{
+    std::lock_guard lock(g_changes_lock);
+    g_marked_rows.rooms.insert(room_id);
+    g_is_init_marked = true;
+}
+
+void mark_building_changed(gaia::common::gaia_id_t building_id)
+{
+    std::lock_guard lock(g_changes_lock);
+    g_marked_rows.buildings.insert(building_id);
+    g_is_init_marked = true;
+}
+
+void invalidate_room(gaia::common::gaia_id_t room_id)
+{
+    g_shared_row_epoch++;
+    mark_room_changed(room_id);
+}
+
+void invalidate_event(gaia::common::gaia_id_t event_id)
+{
+    g_event_fragments.invalidate(event_id);
+    g_shared_row_epoch++;
+
+    // The event may be listed by any number of people and rooms.
+    request_full_snapshot();
+
+    std::lock_guard lock(g_changes_lock);
+    g_is_init_marked = true;
+}
+
+void clear_changes()
+{
+    g_person_fragments.clear();
+    g_event_fragments.clear();
+
+    {
+        std::lock_guard lock(g_changes_lock);
+        g_marked_rows.clear();
+        g_settling_rows.clear();
+        g_is_init_marked = false;
+        g_is_init_settling = false;
+    }
+
+    // The tables were wiped, so the next caller rebuilds the message.
+    std::lock_guard lock(g_init_message_lock);
+    g_init_message.reset();
+}
+
+void request_full_snapshot()
+{
+    std::lock_guard lock(g_changes_lock);
+    g_full_snapshot_requested = true;
+}
+
+// Must be called inside a transaction.
+void publish_delta(const changed_rows_t& changes)
+{
+    json_writer_t& writer = t_message_writer;
+    writer.clear();
+    writer.begin_object();
+
+    writer.key("buildings");
+    writer.begin_array();
+    for (gaia::common::gaia_id_t building_id : changes.buildings)
+    {
+        write_building(writer, building_t::get(building_id), false);
+    }
+    writer.end_array();
+
+    writer.key("people");
+    writer.begin_array();
+    for (gaia::common::gaia_id_t person_id : changes.persons)
+    {
+        write_person(writer, person_t::get(person_id));
+    }
+    writer.end_array();
+
+    writer.key("rooms");
+    writer.begin_array();
+    for (gaia::common::gaia_id_t room_id : changes.rooms)
+    {
+        write_room(writer, room_t::get(room_id), true);
+    }
+    writer.end_array();
+
+    writer.key("seq");
+    writer.value(uint64_t{++g_sequence_number});
+    writer.end_object();
+
+    communication::publish_message(c_delta_topic, writer.str());
+}
+
+void publisher_tick()
+{
+    changed_rows_t changes;
+    bool is_full_snapshot;
+    bool is_init_stale;
+    {
+        std::lock_guard lock(g_changes_lock);
+        changes = std::move(g_settling_rows);
+        g_settling_rows = std::move(g_marked_rows);
+        g_marked_rows.clear();
+        is_full_snapshot = g_full_snapshot_requested;
+        g_full_snapshot_requested = false;
+        is_init_stale = g_is_init_settling;
+        g_is_init_settling = g_is_init_marked;
+        g_is_init_marked = false;
+    }
+
+    // A periodic full snapshot also bounds how stale the cached init message
+    // can get if a change was missed by the marks.
+    if (is_init_stale || is_full_snapshot)
+    {
+        refresh_init_message();
+    }
+
+    if (!is_full_snapshot && changes.empty())
+    {
+        return;
+    }
+
+    // The persons were already invalidated when marked, but that happened
+    // before their transaction committed; a snapshot taken in between may
+    // have cached the old state.
+    for (gaia::common::gaia_id_t person_id : changes.persons)
+    {
+        g_person_fragments.invalidate(person_id);
+    }
+
+    gaia::db::begin_transaction();
+    if (is_full_snapshot)
+    {
+        // A full snapshot supersedes the deltas that were waiting for it.
+        publish_full_snapshot();
+    }
+    else
+    {
+        publish_delta(changes);
+    }
+    gaia::db::commit_transaction();
+}
+
+std::mutex g_publisher_lock;
+std::condition_variable g_publisher_stop;
+bool g_is_publisher_stopping = false;
+std::thread g_publisher;
+
+void start_delta_publisher(std::chrono::milliseconds interval, std::chrono::milliseconds snapshot_interval)
+{
+    {
+        std::lock_guard lock(g_init_message_lock);
+        g_is_publisher_running = true;
+    }
+
+    g_is_publisher_stopping = false;
+    g_publisher = std::thread([interval, snapshot_interval] {
+        gaia::db::begin_session();
+
+        auto last_snapshot_time = std::chrono::steady_clock::now();
+        std::unique_lock lock(g_publisher_lock);
+        while (!g_publisher_stop.wait_for(lock, interval, [] { return g_is_publisher_stopping; }))
+        {
+            lock.unlock();
+            auto now = std::chrono::steady_clock::now();
+            if (snapshot_interval.count() > 0 && now - last_snapshot_time >= snapshot_interval)
+            {
+                request_full_snapshot();
+                last_snapshot_time = now;
+            }
+            // The rows a failed tick took are lost, so the next tick resends
+            // everything.
+            try
+            {
+                publisher_tick();
+            }
+            catch (const std::exception& e)
+            {
+                if (gaia::db::is_transaction_open())
+                {
+                    gaia::db::rollback_transaction();
+                }
+                gaia_log::app().error("Failed to publish UI changes: {}", e.what());
+                request_full_snapshot();
+            }
+            lock.lock();
+        }
+
+        lock.unlock();
+        gaia::db::end_session();
+    });
+}
+
+void stop_delta_publisher()
+{
+    {
+        std::lock_guard lock(g_publisher_lock);
+        g_is_publisher_stopping = true;
+    }
+    g_publisher_stop.notify_one();
+
+    if (g_publisher.joinable())
+    {
+        g_publisher.join();
+    }
+
+    std::lock_guard lock(g_init_message_lock);
+    g_is_publisher_running = false;
+}
+
+} // namespace ui
@@ -0,0 +1,284 @@
+/////////////////////////////////////////////
+// Copyright (c) Gaia Platform LLC
+// All rights reserved.
+/////////////////////////////////////////////
+
+// Prints the records of an audit log directory that match a person and a
+// wall-clock time range, one tab-separated line per record:
+//
+//     wall_time_s  app_time  scan_id  person_id  room_id  building_id  scan_type  outcome  rule  invocation_id
+//
+// rule is the rule_profiler::rule_t of a decision, or "-". Only final
+// decisions are printed: a first pass finds, for every scan and rule, the
+// last invocation that made a decision, and the second pass skips the
+// decisions of earlier, retried invocations.
+//
+// Segments are memory-mapped and scanned in order, so a pass runs at about
+// the speed of the disk.
+//
+// Usage: audit_query <directory> [--person <id>] [--from <unix_s>] [--to <unix_s>]
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "audit_record.hpp"
+#include "enums.hpp"
+
+using audit_log::audit_record_t;
+using audit_log::outcome_t;
+
+const char* const c_scan_type_names[] = {
+    "badge",
+    "vehicle_entering",
+    "vehicle_departing",
+    "joining_wifi",
+    "leaving_wifi",
+    "face",
+    "leaving",
+};
+
+constexpr size_t c_scan_type_count = sizeof(c_scan_type_names) / sizeof(c_scan_type_names[0]);
+static_assert(c_scan_type_count == enums::scan_table::e_scan_type::leaving + 1);
+
+constexpr uint64_t c_nanoseconds_per_second = 1000000000;
+constexpr size_t c_output_buffer_size = 1 << 20;
+
+struct filter_t
+{
+    bool has_person_id = false;
+    uint64_t person_id = 0;
+    uint64_t from_ns = 0;
+    uint64_t to_ns = std::numeric_limits<uint64_t>::max();
+
+    bool matches_person(const audit_record_t& record) const
+    {
+        return !has_person_id || record.person_id == person_id;
+    }
+
+    bool matches(const audit_record_t& record) const
+    {
+        return matches_person(record) && record.wall_time_ns >= from_ns && record.wall_time_ns <= to_ns;
+    }
+};
+
+struct decision_key_t
+{
+    uint64_t scan_id;
+    uint8_t rule;
+
+    bool operator==(const decision_key_t& other) const
+    {
+        return scan_id == other.scan_id && rule == other.rule;
+    }
+};
+
+struct decision_key_hash_t
+{
+    size_t operator()(const decision_key_t& key) const
+    {
+        return std::hash<uint64_t>()(key.scan_id * 0x9E3779B97F4A7C15ull ^ key.rule);
+    }
+};
+
+// The last invocation of each rule that decided about each scan.
+using last_invocations_t = std::unordered_map<decision_key_t, uint64_t, decision_key_hash_t>;
+
+void print_record(const audit_record_t& record)
+{
+    const char* scan_type = record.scan_type < c_scan_type_count ? c_scan_type_names[record.scan_type] : "unknown";
+    size_t outcome = static_cast<size_t>(record.outcome);
+    const char* outcome_name = outcome < static_cast<size_t>(outcome_t::count) ? audit_log::c_outcome_names[outcome] : "unknown";
+
+    printf("%" PRIu64 ".%09" PRIu64 "\t%" PRIu64 "\t%" PRIu64 "\t%" PRIu64 "\t%" PRIu64 "\t%" PRIu64 "\t%s\t%s\t",
+        record.wall_time_ns / c_nanoseconds_per_second, record.wall_time_ns % c_nanoseconds_per_second,
+        record.app_time, record.scan_id, record.person_id, record.room_id, record.building_id,
+        scan_type, outcome_name);
+    if (record.rule == audit_log::c_no_rule)
+    {
+        printf("-\t-\n");
+    }
+    else
+    {
+        printf("%u\t%" PRIu64 "\n", record.rule, record.invocation_id);
+    }
+}
+
+// Calls on_record for every record of the segment. Returns the number of
+// records in the segment, or -1 if it cannot be read.
+template <typename T_on_record>
+int64_t scan_segment(const std::string& path, T_on_record on_record)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        fprintf(stderr, "Could not open '%s': %s\n", path.c_str(), strerror(errno));
+        return -1;
+    }
+
+    struct stat status;
+    if (fstat(fd, &status) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    // A trailing partial record is ignored.
+    size_t record_count = status.st_size / sizeof(audit_record_t);
+    if (record_count == 0)
+    {
+        close(fd);
+        return 0;
+    }
+
+    size_t length = record_count * sizeof(audit_record_t);
+    void* data = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        fprintf(stderr, "Could not map '%s': %s\n", path.c_str(), strerror(errno));
+        return -1;
+    }
+    madvise(data, length, MADV_SEQUENTIAL);
+
+    const auto* records = static_cast<const audit_record_t*>(data);
+    for (size_t i = 0; i < record_count; i++)
+    {
+        on_record(records[i]);
+    }
+
+    munmap(data, length);
+    return record_count;
+}
+
+bool parse_uint(const char* text, uint64_t& value)
+{
+    char* end;
+    errno = 0;
+    value = strtoull(text, &end, 10);
+    return errno == 0 && end != text && *end == '\0';
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2 || argc % 2 != 0)
+    {
+        fprintf(stderr, "Usage: %s <directory> [--person <id>] [--from <unix_s>] [--to <unix_s>]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    filter_t filter;
+    for (int i = 2; i < argc; i += 2)
+    {
+        std::string option = argv[i];
+        uint64_t value;
+        if (!parse_uint(argv[i + 1], value))
+        {
+            fprintf(stderr, "Invalid value '%s' for %s.\n", argv[i + 1], option.c_str());
+            return EXIT_FAILURE;
+        }
+
+        if (option == "--person")
+        {
+            filter.has_person_id = true;
+            filter.person_id = value;
+        }
+        else if (option == "--from")
+        {
+            filter.from_ns = value * c_nanoseconds_per_second;
+        }
+        else if (option == "--to")
+        {
+            // The whole last second is included.
+            filter.to_ns = (value + 1) * c_nanoseconds_per_second - 1;
+        }
+        else
+        {
+            fprintf(stderr, "Unknown option '%s'.\n", option.c_str());
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::vector<std::string> segment_paths;
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(argv[1], error))
+    {
+        std::string name = entry.path().filename().string();
+        if (name.rfind("audit-", 0) == 0 && entry.path().extension() == ".log")
+        {
+            segment_paths.push_back(entry.path().string());
+        }
+    }
+    if (error)
+    {
+        fprintf(stderr, "Could not list '%s': %s\n", argv[1], error.message().c_str());
+        return EXIT_FAILURE;
+    }
+
+    // Sequence numbers are zero-padded, so names sort in writing order.
+    std::sort(segment_paths.begin(), segment_paths.end());
+
+    setvbuf(stdout, nullptr, _IOFBF, c_output_buffer_size);
+
+    // A scan's records all name the same person, so the person filter can
+    // already narrow the first pass.
+    last_invocations_t last_invocations;
+    for (const std::string& path : segment_paths)
+    {
+        int64_t segment_record_count = scan_segment(path, [&](const audit_record_t& record) {
+            if (record.rule != audit_log::c_no_rule && filter.matches_person(record))
+            {
+                uint64_t& last_invocation = last_invocations[{record.scan_id, record.rule}];
+                last_invocation = std::max(last_invocation, record.invocation_id);
+            }
+        });
+        if (segment_record_count < 0)
+        {
+            return EXIT_FAILURE;
+        }
+    }
+
+    uint64_t record_count = 0;
+    uint64_t match_count = 0;
+    uint64_t superseded_count = 0;
+    for (const std::string& path : segment_paths)
+    {
+        int64_t segment_record_count = scan_segment(path, [&](const audit_record_t& record) {
+            if (!filter.matches(record))
+            {
+                return;
+            }
+            if (record.rule != audit_log::c_no_rule
+                && record.invocation_id != last_invocations.find({record.scan_id, record.rule})->second)
+            {
+                superseded_count++;
+                return;
+            }
+            print_record(record);
+            match_count++;
+        });
+        if (segment_record_count < 0)
+        {
+            return EXIT_FAILURE;
+        }
+        record_count += segment_record_count;
+    }
+
+    fflush(stdout);
+    fprintf(stderr, "%" PRIu64 " of %" PRIu64 " records in %zu segments matched; %" PRIu64 " superseded decisions skipped.\n",
+        match_count, record_count, segment_paths.size(), superseded_count);
+    return EXIT_SUCCESS;
+}